@@ -12,9 +12,11 @@
 #include "CommonUtil.h"
 
 /* Private File-based Logging just for Debugging */
-#ifdef PRIVATE_LOG_PATH
-static FILE* private_log_file = NULL;
-#endif
+#include "PrivateLog.h"
+#include "BinaryLog.h"
+#include "UsdtProbes.h"
+#include "TraceEvents.h"
+#include "AccessPlan.h"
 
 void fmi_verbose_log_global(const char* format, ...)
 {
@@ -22,49 +24,38 @@ void fmi_verbose_log_global(const char* format, ...)
 #ifdef PRIVATE_LOG_PATH
     va_list ap;
     va_start(ap, format);
-    if (private_log_file == NULL)
-        private_log_file = fopen(PRIVATE_LOG_PATH,"a");
-    if (private_log_file != NULL) {
-        fprintf(private_log_file,"DynamicArrayTest::Global: ");
-        vfprintf(private_log_file, format, ap);
-        fputc('\n',private_log_file);
-        fflush(private_log_file);
-    }
+    private_log_vprintf("DynamicArrayTest::Global: ",format,ap);
+    va_end(ap);
 #endif
 #endif
 }
 
-void internal_log(DynamicArrayTest component,const char* category, const char* format, va_list arg)
+void internal_log(DynamicArrayTest component, unsigned int category, const char* format, va_list arg)
 {
-#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
+#ifdef PRIVATE_LOG_BINARY
+    va_list binary_arg;
+    va_copy(binary_arg, arg);
+    binary_log_vrecord(component->binaryLog,category,format,binary_arg);
+    va_end(binary_arg);
+#endif
+#if (defined(PRIVATE_LOG_PATH) && !defined(PRIVATE_LOG_BINARY)) || defined(PUBLIC_LOGGING)
     char buffer[1024];
+#if !defined(PRIVATE_LOG_PATH) || defined(PRIVATE_LOG_BINARY)
+    if (!component->loggingOn || !(component->loggingCategoryMask & category))
+        return;
+#endif
 #ifdef _WIN32
     vsnprintf_s(buffer, 1024, _TRUNCATE, format, arg);
 #else
     vsnprintf(buffer, 1024, format, arg);
     buffer[1023]='\0';
 #endif
-#ifdef PRIVATE_LOG_PATH
-    if (private_log_file == NULL)
-        private_log_file = fopen(PRIVATE_LOG_PATH,"a");
-    if (private_log_file != NULL) {
-        fprintf(private_log_file,"DynamicArrayTest::%s<%p>: %s\n",component->instanceName,component,buffer);
-        fflush(private_log_file);
-    }
+#if defined(PRIVATE_LOG_PATH) && !defined(PRIVATE_LOG_BINARY)
+    private_log_printf("DynamicArrayTest::%s<%p>: %s",component->instanceName,component,buffer);
 #endif
 #ifdef PUBLIC_LOGGING
-    if (component->loggingOn) {
-        size_t i;
-        int active = component->nCategories == 0;
-        for (i=0;i<component->nCategories;i++) {
-            if (0==strcmp(category,component->loggingCategories[i])) {
-                active = 1;
-                break;
-            }
-        }
-        if (active)
-            component->functions.logMessage(component->functions.instanceEnvironment,fmi3OK,category,buffer);
-    }
+    if (component->loggingOn && (component->loggingCategoryMask & category))
+        component->functions.logMessage(component->functions.instanceEnvironment,fmi3OK,log_category_name(category),buffer);
 #endif
 #endif
 }
@@ -74,13 +65,13 @@ void fmi_verbose_log(DynamicArrayTest component,const char* format, ...)
 #if defined(VERBOSE_FMI_LOGGING) && (defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING))
     va_list ap;
     va_start(ap, format);
-    internal_log(component,"FMI",format,ap);
+    internal_log(component,LOG_CATEGORY_FMI,format,ap);
     va_end(ap);
 #endif
 }
 
 /* Normal Logging */
-void normal_log(DynamicArrayTest component, const char* category, const char* format, ...) {
+void normal_log(DynamicArrayTest component, unsigned int category, const char* format, ...) {
 #if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
     va_list ap;
     va_start(ap, format);
@@ -90,29 +81,395 @@ void normal_log(DynamicArrayTest component, const char* category, const char* fo
 }
 
 /* Mandatory Error Logging */
-void error_log(DynamicArrayTest component, const char* format, ...) {
+void error_log(DynamicArrayTest component, unsigned int kind, const char* format, ...) {
     va_list ap;
-    va_start(ap, format);
     char buffer[1024];
+    component->errorCounts[kind]++;
+    if (!component->loggingOn || !component->functions.logMessage || !(component->loggingCategoryMask & LOG_CATEGORY_FMI))
+        return;
+    va_start(ap, format);
 #ifdef _WIN32
     vsnprintf_s(buffer, 1024, _TRUNCATE, format, ap);
 #else
     vsnprintf(buffer, 1024, format, ap);
     buffer[1023]='\0';
 #endif
-    if (component->loggingOn && component->functions.logMessage) {
-        size_t i;
-        int active = component->nCategories == 0;
-        for (i=0;i<component->nCategories;i++) {
-            if (0==strcmp("FMI",component->loggingCategories[i])) {
-                active = 1;
-                break;
-            }
-        }
-        if (active)
-            component->functions.logMessage(component->functions.instanceEnvironment,fmi3Error,"FMI",buffer);
-    }
     va_end(ap);
+    component->functions.logMessage(component->functions.instanceEnvironment,fmi3Error,"FMI",buffer);
+}
+
+/* Performance Counters, counting while the PERF category is logged */
+void update_perf_counters(DynamicArrayTest component)
+{
+#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
+    if (!perf_activate(&component->perf,component->loggingOn && (component->loggingCategoryMask & LOG_CATEGORY_PERF)))
+        error_log(component,FMI3X_ERROR_MEMORY,"Out of memory allocating performance counters.");
+#endif
+}
+
+void log_perf_counters(DynamicArrayTest component)
+{
+#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
+    char buffer[1024];
+    int function;
+    for (function = 0; function<PERF_FUNCTIONS; function++)
+        if (perf_format(component->perf,(PerfFunction)function,buffer,sizeof(buffer)))
+            normal_log(component,LOG_CATEGORY_PERF,"%s",buffer);
+#endif
+}
+
+/*
+ * Elementwise Product Kernels
+ *
+ * For large arrays doCalc is dominated by the elementwise product,
+ * so explicitly vectorized variants are provided for x86 and the
+ * widest one supported by the running CPU is selected at run-time.
+ * The arrays are cache line aligned, but the kernels use unaligned
+ * loads and stores, which cost nothing extra on aligned data.  The
+ * multiply_add variants accumulate the product into the output and
+ * are used for the partial derivatives.
+ */
+
+static void multiply_scalar(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i<size;i++)
+        output[i]=a[i]*b[i];
+}
+
+static void multiply_add_scalar(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i<size;i++)
+        output[i]+=a[i]*b[i];
+}
+
+#ifdef FMU_SIMD_X86
+static FMU_TARGET("sse2") void multiply_sse2(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i+2<=size;i+=2)
+        _mm_storeu_pd(output+i,_mm_mul_pd(_mm_loadu_pd(a+i),_mm_loadu_pd(b+i)));
+    for (;i<size;i++)
+        output[i]=a[i]*b[i];
+}
+
+static FMU_TARGET("avx") void multiply_avx(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i+8<=size;i+=8) {
+        _mm256_storeu_pd(output+i,_mm256_mul_pd(_mm256_loadu_pd(a+i),_mm256_loadu_pd(b+i)));
+        _mm256_storeu_pd(output+i+4,_mm256_mul_pd(_mm256_loadu_pd(a+i+4),_mm256_loadu_pd(b+i+4)));
+    }
+    for (;i<size;i++)
+        output[i]=a[i]*b[i];
+}
+
+static FMU_TARGET("avx512f") void multiply_avx512(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i+8<=size;i+=8)
+        _mm512_storeu_pd(output+i,_mm512_mul_pd(_mm512_loadu_pd(a+i),_mm512_loadu_pd(b+i)));
+    if (i<size) {
+        __mmask8 mask = (__mmask8)((1u << (size-i)) - 1u);
+        _mm512_mask_storeu_pd(output+i,mask,_mm512_mul_pd(_mm512_maskz_loadu_pd(mask,a+i),_mm512_maskz_loadu_pd(mask,b+i)));
+    }
+}
+
+static FMU_TARGET("sse2") void multiply_add_sse2(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i+2<=size;i+=2)
+        _mm_storeu_pd(output+i,_mm_add_pd(_mm_loadu_pd(output+i),_mm_mul_pd(_mm_loadu_pd(a+i),_mm_loadu_pd(b+i))));
+    for (;i<size;i++)
+        output[i]+=a[i]*b[i];
+}
+
+static FMU_TARGET("avx") void multiply_add_avx(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i+8<=size;i+=8) {
+        _mm256_storeu_pd(output+i,_mm256_add_pd(_mm256_loadu_pd(output+i),_mm256_mul_pd(_mm256_loadu_pd(a+i),_mm256_loadu_pd(b+i))));
+        _mm256_storeu_pd(output+i+4,_mm256_add_pd(_mm256_loadu_pd(output+i+4),_mm256_mul_pd(_mm256_loadu_pd(a+i+4),_mm256_loadu_pd(b+i+4))));
+    }
+    for (;i<size;i++)
+        output[i]+=a[i]*b[i];
+}
+
+static FMU_TARGET("avx512f") void multiply_add_avx512(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size)
+{
+    size_t i;
+    for (i=0;i+8<=size;i+=8)
+        _mm512_storeu_pd(output+i,_mm512_add_pd(_mm512_loadu_pd(output+i),_mm512_mul_pd(_mm512_loadu_pd(a+i),_mm512_loadu_pd(b+i))));
+    if (i<size) {
+        __mmask8 mask = (__mmask8)((1u << (size-i)) - 1u);
+        _mm512_mask_storeu_pd(output+i,mask,_mm512_add_pd(_mm512_maskz_loadu_pd(mask,output+i),
+            _mm512_mul_pd(_mm512_maskz_loadu_pd(mask,a+i),_mm512_maskz_loadu_pd(mask,b+i))));
+    }
+}
+#endif
+
+static void select_multiply_kernels(DynamicArrayTest component)
+{
+    component->multiply = multiply_scalar;
+    component->multiply_add = multiply_add_scalar;
+#ifdef FMU_SIMD_X86
+    fmu_cpu_init();
+    if (fmu_cpu_has_avx512f()) {
+        component->multiply = multiply_avx512;
+        component->multiply_add = multiply_add_avx512;
+    } else if (fmu_cpu_has_avx()) {
+        component->multiply = multiply_avx;
+        component->multiply_add = multiply_add_avx;
+    } else if (fmu_cpu_has_sse2()) {
+        component->multiply = multiply_sse2;
+        component->multiply_add = multiply_add_sse2;
+    }
+#endif
+}
+
+/*
+ * Worker Pool
+ *
+ * The pool is a simple fork/join scheme: doCalc bumps the pool
+ * generation to start all workers, calculates the first partition
+ * on the calling thread and then waits until all workers are done.
+ * Partitions are whole cache lines, so that threads never write to
+ * the same line of the output array.
+ */
+
+static size_t resolve_thread_count(DynamicArrayTest component)
+{
+    size_t threads = (size_t)component->threads;
+    if (threads == 0) {
+        const char* env = getenv(DYNAMIC_ARRAY_THREADS_ENV);
+        if (env != NULL)
+            threads = (size_t)strtoul(env,NULL,10);
+    }
+    if (threads == 0)
+        threads = 1;
+    if (threads > DYNAMIC_ARRAY_MAX_THREADS)
+        threads = DYNAMIC_ARRAY_MAX_THREADS;
+    return threads;
+}
+
+static void multiply_partition(DynamicArrayTest component, size_t index, size_t parts)
+{
+    const size_t line = FMU_CACHE_LINE_SIZE/sizeof(fmi3Float64);
+    size_t size = component->x_dimension_size*component->y_dimension_size;
+    size_t chunk = ((size + parts - 1) / parts + line - 1) / line * line;
+    size_t begin = index*chunk, end = begin+chunk;
+    if (begin >= size)
+        return;
+    if (end > size)
+        end = size;
+    component->multiply(component->float64_output+begin,component->float64_input+begin,component->float64_parameter+begin,end-begin);
+}
+
+FMU_THREAD_FUNCTION(worker_main,arg)
+{
+    DynamicArrayTestWorker* worker = (DynamicArrayTestWorker*)arg;
+    DynamicArrayTest component = worker->component;
+    unsigned long generation = 0;
+
+    fmu_mutex_lock(&component->pool_mutex);
+    for (;;) {
+        while (!component->pool_shutdown && component->pool_generation == generation)
+            fmu_cond_wait(&component->pool_start,&component->pool_mutex);
+        if (component->pool_shutdown)
+            break;
+        generation = component->pool_generation;
+        fmu_mutex_unlock(&component->pool_mutex);
+        multiply_partition(component,worker->index,component->n_workers+1);
+        fmu_mutex_lock(&component->pool_mutex);
+        if (--component->pool_pending == 0)
+            fmu_cond_signal(&component->pool_done);
+    }
+    fmu_mutex_unlock(&component->pool_mutex);
+    FMU_THREAD_RETURN;
+}
+
+static void stop_worker_pool(DynamicArrayTest component)
+{
+    size_t i;
+    if (component->workers == NULL)
+        return;
+    fmu_mutex_lock(&component->pool_mutex);
+    component->pool_shutdown = 1;
+    fmu_cond_broadcast(&component->pool_start);
+    fmu_mutex_unlock(&component->pool_mutex);
+    for (i=0;i<component->n_workers;i++)
+        fmu_thread_join(component->workers[i].thread);
+    fmu_cond_destroy(&component->pool_done);
+    fmu_cond_destroy(&component->pool_start);
+    fmu_mutex_destroy(&component->pool_mutex);
+    free(component->workers);
+    component->workers = NULL;
+    component->n_workers = 0;
+}
+
+static void start_worker_pool(DynamicArrayTest component)
+{
+    size_t i, n = resolve_thread_count(component) - 1;
+    component->n_workers = 0;
+    component->workers = NULL;
+    if (n == 0)
+        return;
+    component->workers = calloc(n,sizeof(DynamicArrayTestWorker));
+    if (component->workers == NULL) {
+        normal_log(component,LOG_CATEGORY_FMI,"Cannot allocate worker pool, calculating single-threaded.");
+        return;
+    }
+    fmu_mutex_init(&component->pool_mutex);
+    fmu_cond_init(&component->pool_start);
+    fmu_cond_init(&component->pool_done);
+    component->pool_generation = 0;
+    component->pool_pending = 0;
+    component->pool_shutdown = 0;
+    for (i=0;i<n;i++) {
+        component->workers[i].component = component;
+        component->workers[i].index = i+1;
+        if (!fmu_thread_create(&component->workers[i].thread,worker_main,&component->workers[i]))
+            break;
+        component->n_workers++;
+    }
+    if (component->n_workers < n)
+        normal_log(component,LOG_CATEGORY_FMI,"Only %zu of %zu worker threads could be started.",component->n_workers,n);
+    if (component->n_workers == 0) {
+        fmu_cond_destroy(&component->pool_done);
+        fmu_cond_destroy(&component->pool_start);
+        fmu_mutex_destroy(&component->pool_mutex);
+        free(component->workers);
+        component->workers = NULL;
+    }
+}
+
+static void parallel_multiply(DynamicArrayTest component)
+{
+    size_t size = component->x_dimension_size*component->y_dimension_size;
+
+    if (component->n_workers == 0 || size < DYNAMIC_ARRAY_PARALLEL_THRESHOLD) {
+        component->multiply(component->float64_output,component->float64_input,component->float64_parameter,size);
+        return;
+    }
+
+    fmu_mutex_lock(&component->pool_mutex);
+    component->pool_pending = component->n_workers;
+    component->pool_generation++;
+    fmu_cond_broadcast(&component->pool_start);
+    fmu_mutex_unlock(&component->pool_mutex);
+
+    multiply_partition(component,0,component->n_workers+1);
+
+    fmu_mutex_lock(&component->pool_mutex);
+    while (component->pool_pending > 0)
+        fmu_cond_wait(&component->pool_done,&component->pool_mutex);
+    fmu_mutex_unlock(&component->pool_mutex);
+}
+
+/*
+ * Array Arena
+ *
+ * Parameter, input and output arrays live in one cache line aligned
+ * allocation, so that resizing is a single allocation and the kernel
+ * streams through one contiguous block.  Each section is padded to
+ * whole cache lines, and the sections are staggered by one extra
+ * cache line so that the three streams never alias modulo 4 KiB.
+ * The logical contents of all arrays are preserved on resizing.
+ * array_generation counts the changes of where the arrays are and how
+ * large they are, for prepared access plans to notice.
+ */
+
+/* Distance of the sections in an arena of capacity elements per array */
+static FMU_INLINE size_t arena_stride(size_t capacity)
+{
+    return capacity + FMU_CACHE_LINE_SIZE/sizeof(fmi3Float64);
+}
+
+/* Largest capacity whose rounded up arena size in bytes cannot overflow */
+#define ARENA_MAX_CAPACITY (((size_t)-1)/(3*sizeof(fmi3Float64)) - 2*FMU_CACHE_LINE_SIZE/sizeof(fmi3Float64))
+
+static fmi3Status resize_arena(DynamicArrayTest component, size_t capacity)
+{
+    const size_t line = FMU_CACHE_LINE_SIZE/sizeof(fmi3Float64);
+    size_t stride;
+    fmi3Float64* arena;
+
+    if (capacity > ARENA_MAX_CAPACITY)
+        return fmi3Error;
+    capacity = (capacity + line - 1) / line * line;
+    stride = arena_stride(capacity);
+    arena = myalignedcalloc(3*stride,sizeof(fmi3Float64));
+    if (arena == NULL)
+        return fmi3Error;
+    if (component->arena != NULL) {
+        memcpy(arena,component->float64_parameter,component->array_size*sizeof(fmi3Float64));
+        memcpy(arena+stride,component->float64_input,component->array_size*sizeof(fmi3Float64));
+        memcpy(arena+2*stride,component->float64_output,component->array_size*sizeof(fmi3Float64));
+        myalignedfree(component->arena);
+    }
+    component->arena = arena;
+    component->float64_parameter = arena;
+    component->float64_input = arena+stride;
+    component->float64_output = arena+2*stride;
+    component->input_buffer = NULL;
+    component->output_buffer = NULL;
+    component->array_capacity = capacity;
+    component->array_generation++;
+    component->output_generation++;
+    return fmi3OK;
+}
+
+/* Grow geometrically, so that sweeps over sizes reallocate rarely */
+static fmi3Status grow_arena(DynamicArrayTest component, size_t size)
+{
+    size_t capacity = component->array_capacity ? component->array_capacity : 1;
+    while (capacity < size)
+        capacity = (capacity <= ARENA_MAX_CAPACITY/2) ? capacity*2 : size;
+    return resize_arena(component,capacity);
+}
+
+/*
+ * Shared Arrays
+ *
+ * Hosts can borrow the output array read-only instead of copying it
+ * out (fmi3xBorrowFloat64Output), or bind a buffer of their own that
+ * doCalc calculates into directly (fmi3xBindFloat64Output), in which
+ * case float64_output points to output_buffer instead of the arena.
+ * output_generation counts the changes of the output values and of
+ * where they are.  Likewise hosts can bind a buffer of their own that
+ * doCalc reads the input from (fmi3xBindFloat64Input), in which case
+ * float64_input points to input_buffer.  That buffer is never written
+ * to, so setting the input while it is bound is an error, and
+ * restoring an FMU state drops the binding.  A bound buffer only ever
+ * holds its array at the size it was bound at: before the arrays
+ * change size its contents are copied back into the arena and the
+ * binding is dropped.
+ */
+
+static void unbind_input(DynamicArrayTest component)
+{
+    fmi3Float64* input;
+    if (component->input_buffer == NULL)
+        return;
+    input = component->arena + arena_stride(component->array_capacity);
+    memcpy(input,component->input_buffer,component->array_size*sizeof(fmi3Float64));
+    component->float64_input = input;
+    component->input_buffer = NULL;
+    component->array_generation++;
+}
+
+static void unbind_output(DynamicArrayTest component)
+{
+    fmi3Float64* output;
+    if (component->output_buffer == NULL)
+        return;
+    output = component->arena + 2*arena_stride(component->array_capacity);
+    memcpy(output,component->output_buffer,component->array_size*sizeof(fmi3Float64));
+    component->float64_output = output;
+    component->output_buffer = NULL;
+    component->array_generation++;
+    component->output_generation++;
 }
 
 /*
@@ -128,18 +485,29 @@ fmi3Status doInit(DynamicArrayTest component)
     component->y_dimension_size = 3;
 
     /* Arrays */
-    component->float64_parameter = calloc(component->x_dimension_size*component->y_dimension_size,sizeof(fmi3Float64));
-    component->float64_input = calloc(component->x_dimension_size*component->y_dimension_size,sizeof(fmi3Float64));
-    component->float64_output = calloc(component->x_dimension_size*component->y_dimension_size,sizeof(fmi3Float64));
+    component->arena = NULL;
+    component->array_size = 0;
+    if (resize_arena(component,component->x_dimension_size*component->y_dimension_size) != fmi3OK)
+        return fmi3Error;
+    component->array_size = component->x_dimension_size*component->y_dimension_size;
+
+    select_multiply_kernels(component);
+
+    /* Worker Pool */
+    component->threads = 0;
+    start_worker_pool(component);
 
     return fmi3OK;
 }
 
 fmi3Status doInitCalc(DynamicArrayTest component)
 {
+    fmi3UInt64 perf_start = perf_begin(component->perf);
+    trace_begin(component->traceInstance,"doInitCalc");
+    probe_entry(component,0,0.0);
     DEBUGBREAK();
 
-    return fmi3OK;
+    return trace_return(perf_end(component->perf,PERF_DO_INIT_CALC,perf_start,fmi3OK));
 }
 
 fmi3Status doEnterInitializationMode(DynamicArrayTest component, fmi3Boolean toleranceDefined, fmi3Float64 tolerance, fmi3Float64 startTime, fmi3Boolean stopTimeDefined, fmi3Float64 stopTime)
@@ -158,20 +526,21 @@ fmi3Status doExitInitializationMode(DynamicArrayTest component)
 
 fmi3Status doCalc(DynamicArrayTest component, fmi3Float64 currentCommunicationPoint, fmi3Float64 communicationStepSize, fmi3Boolean noSetFMUStatePriorToCurrentPoint, fmi3Boolean* eventHandlingNeeded, fmi3Boolean* terminateSimulation, fmi3Boolean* earlyReturn, fmi3Float64* lastSuccessfulTime)
 {
-    size_t i,size;
+    trace_begin(component->traceInstance,"doCalc");
+    probe_entry(component,0,communicationStepSize);
     DEBUGBREAK();
 
     doInitCalc(component);
 
-    for (i=0,size=component->x_dimension_size*component->y_dimension_size;i<size;i++)
-        component->float64_output[i]=component->float64_input[i]*component->float64_parameter[i];
+    parallel_multiply(component);
+    component->output_generation++;
 
     component->last_time=currentCommunicationPoint+communicationStepSize;
     *lastSuccessfulTime = component->last_time;
     *eventHandlingNeeded = fmi3False;
     *earlyReturn = fmi3False;
     *terminateSimulation = fmi3False;
-    return fmi3OK;
+    return trace_return(fmi3OK);
 }
 
 fmi3Status doTerm(DynamicArrayTest component)
@@ -184,9 +553,160 @@ void doFree(DynamicArrayTest component)
 {
     DEBUGBREAK();
 
-    free(component->float64_parameter);
-    free(component->float64_input);
-    free(component->float64_output);
+    stop_worker_pool(component);
+
+    myalignedfree(component->arena);
+    component->arena = NULL;
+    component->float64_parameter = NULL;
+    component->float64_input = NULL;
+    component->float64_output = NULL;
+    component->input_buffer = NULL;
+    component->output_buffer = NULL;
+    component->array_size = 0;
+    component->array_capacity = 0;
+}
+
+/*
+ * FMU State Snapshots
+ *
+ * Snapshots are pooled per instance: fmi3FreeFMUState returns them to
+ * the pool and fmi3GetFMUState reuses pooled snapshots together with
+ * their array buffers, so that saving and restoring state in a loop
+ * does not allocate once the pool is warm.  All snapshots are released
+ * when the instance is freed.  Threads only controls how the results
+ * are calculated, so it is not part of the saved state.
+ */
+
+static DynamicArrayTestState acquire_state(DynamicArrayTest component)
+{
+    DynamicArrayTestState state = component->free_states;
+    if (state != NULL) {
+        component->free_states = state->next_free;
+    } else {
+        state = calloc(1,sizeof(struct DynamicArrayTestState));
+        if (state == NULL)
+            return NULL;
+        state->next_allocated = component->allocated_states;
+        component->allocated_states = state;
+    }
+    state->next_free = NULL;
+    state->pooled = 0;
+    return state;
+}
+
+static void release_state(DynamicArrayTest component, DynamicArrayTestState state)
+{
+    state->pooled = 1;
+    state->next_free = component->free_states;
+    component->free_states = state;
+}
+
+static void free_all_states(DynamicArrayTest component)
+{
+    while (component->allocated_states != NULL) {
+        DynamicArrayTestState state = component->allocated_states;
+        component->allocated_states = state->next_allocated;
+        myalignedfree(state->arrays);
+        free(state);
+    }
+    component->free_states = NULL;
+}
+
+static fmi3Status save_state(DynamicArrayTest component, DynamicArrayTestState state)
+{
+    size_t size = component->array_size;
+    if (state->arrays == NULL || state->capacity < size) {
+        fmi3Float64* arrays = myalignedcalloc(3*size,sizeof(fmi3Float64));
+        if (arrays == NULL)
+            return fmi3Error;
+        myalignedfree(state->arrays);
+        state->arrays = arrays;
+        state->capacity = size;
+    }
+    state->x_dimension_size = component->x_dimension_size;
+    state->y_dimension_size = component->y_dimension_size;
+    memcpy(state->arrays,component->float64_parameter,size*sizeof(fmi3Float64));
+    memcpy(state->arrays+size,component->float64_input,size*sizeof(fmi3Float64));
+    memcpy(state->arrays+2*size,component->float64_output,size*sizeof(fmi3Float64));
+    state->last_time = component->last_time;
+    return fmi3OK;
+}
+
+static fmi3Status restore_state(DynamicArrayTest component, DynamicArrayTestState state)
+{
+    size_t size = state->x_dimension_size*state->y_dimension_size;
+    unbind_input(component);
+    if (size != component->array_size)
+        unbind_output(component);
+    if (size > component->array_capacity && grow_arena(component,size) != fmi3OK)
+        return fmi3Error;
+    component->x_dimension_size = state->x_dimension_size;
+    component->y_dimension_size = state->y_dimension_size;
+    if (size != component->array_size)
+        component->array_generation++;
+    component->array_size = size;
+    memcpy(component->float64_parameter,state->arrays,size*sizeof(fmi3Float64));
+    memcpy(component->float64_input,state->arrays+size,size*sizeof(fmi3Float64));
+    memcpy(component->float64_output,state->arrays+2*size,size*sizeof(fmi3Float64));
+    component->output_generation++;
+    component->last_time = state->last_time;
+    return fmi3OK;
+}
+
+/*
+ * Serialized snapshots are the common state header, followed by the
+ * time, the XSize and YSize dimensions, and the parameter, input and
+ * output arrays of XSize*YSize values each.
+ */
+
+static size_t serialized_state_size(DynamicArrayTestState state)
+{
+    size_t size = (size_t)(state->x_dimension_size*state->y_dimension_size);
+    return state_header_size(FMU_TOKEN) + sizeof(state->last_time) + 2*sizeof(fmi3UInt64) + 3*size*sizeof(fmi3Float64);
+}
+
+static void serialize_state(DynamicArrayTestState state, fmi3Byte* out)
+{
+    size_t size = (size_t)(state->x_dimension_size*state->y_dimension_size);
+    out = put_state_header(out,FMU_TOKEN);
+    out = put_values(out,&state->last_time,1,sizeof(state->last_time));
+    out = put_uint64(out,state->x_dimension_size);
+    out = put_uint64(out,state->y_dimension_size);
+    put_values(out,state->arrays,3*size,sizeof(fmi3Float64));
+}
+
+static int deserialize_state(DynamicArrayTestState state, const fmi3Byte* in, size_t length)
+{
+    FMUStateReader reader;
+    fmi3UInt64 x_size, y_size;
+    size_t size;
+    reader.pos = in;
+    reader.end = in + length;
+    reader.ok = 1;
+    get_state_header(&reader,FMU_TOKEN);
+    get_values(&reader,&state->last_time,1,sizeof(state->last_time));
+    x_size = get_uint64(&reader);
+    y_size = get_uint64(&reader);
+    if (!reader.ok)
+        return 0;
+    /* Check the dimensions against the remaining input before allocating */
+    if (y_size != 0 && x_size > (fmi3UInt64)(reader.end - reader.pos) / (3*sizeof(fmi3Float64)) / y_size)
+        return 0;
+    size = (size_t)(x_size*y_size);
+    if (3*size*sizeof(fmi3Float64) != (size_t)(reader.end - reader.pos))
+        return 0;
+    if (state->arrays == NULL || state->capacity < size) {
+        fmi3Float64* arrays = myalignedcalloc(3*size,sizeof(fmi3Float64));
+        if (arrays == NULL)
+            return 0;
+        myalignedfree(state->arrays);
+        state->arrays = arrays;
+        state->capacity = size;
+    }
+    state->x_dimension_size = x_size;
+    state->y_dimension_size = y_size;
+    get_values(&reader,state->arrays,3*size,sizeof(fmi3Float64));
+    return reader.ok && reader.pos == reader.end;
 }
 
 /*
@@ -195,37 +715,31 @@ void doFree(DynamicArrayTest component)
 
 FMI3_Export const char* fmi3GetVersion()
 {
+    trace_begin(0,"fmi3GetVersion");
+    probe_entry(NULL,0,0.0);
+    trace_end();
     return fmi3Version;
 }
 
 FMI3_Export fmi3Status fmi3SetDebugLogging(fmi3Instance instance, fmi3Boolean loggingOn, size_t nCategories, const fmi3String categories[])
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3SetDebugLogging");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3SetDebugLogging(%s)", loggingOn ? "true" : "false");
     myc->loggingOn = loggingOn ? 1 : 0;
 
-    for (;myc->loggingCategories!=NULL && myc->nCategories>0;) free(myc->loggingCategories[--(myc->nCategories)]);
-    free(myc->loggingCategories);
-    myc->loggingCategories = NULL;
-    myc->nCategories = 0;
-
     if (categories && (nCategories > 0)) {
-        myc->loggingCategories = calloc(nCategories,sizeof(char*));
-        if (myc->loggingCategories != NULL) {
-            size_t i;
-            myc->nCategories = nCategories;
-            for (i=0;i<nCategories;i++) myc->loggingCategories[i]=safe_strdup(categories[i],strdup(""));
-        }
+        size_t i;
+        myc->loggingCategoryMask = 0;
+        for (i=0;i<nCategories;i++) myc->loggingCategoryMask |= log_category_mask(categories[i]);
     } else {
-        myc->loggingCategories = calloc(2,sizeof(char*));
-        if (myc->loggingCategories != NULL) {
-            myc->nCategories = 2;
-            myc->loggingCategories[0] = strdup("FMI");
-            myc->loggingCategories[1] = strdup("BINARY");
-        }
+        myc->loggingCategoryMask = LOG_CATEGORIES_ALL;
     }
 
-    return fmi3OK;
+    update_perf_counters(myc);
+
+    return trace_return(fmi3OK);
 }
 
 /*
@@ -247,6 +761,8 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
 {
     DynamicArrayTest myc = NULL;
 
+    trace_begin(0,"fmi3InstantiateCoSimulation");
+    probe_entry(NULL,0,0.0);
 #ifdef FMU_TOKEN
     if (instantiationToken!=NULL && 0!=strcmp(instantiationToken,FMU_TOKEN)) {
         fmi_verbose_log_global("fmi3InstantiateCoSimulation(\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,...) = NULL (GUID mismatch, expected %s)",
@@ -254,6 +770,7 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
             (resourcePath != NULL) ? resourcePath : "<NULL>",
             visible, loggingOn, eventModeUsed, earlyReturnAllowed,
             FMU_TOKEN);
+        trace_end();
         return NULL;
     }
 #endif
@@ -265,9 +782,12 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
             instanceName, instantiationToken,
             (resourcePath != NULL) ? resourcePath : "<NULL>",
             visible, loggingOn, eventModeUsed, earlyReturnAllowed);
+        trace_end();
         return NULL;
     }
 
+    private_log_attach();
+
     myc->instanceName=safe_strdup(instanceName,strdup(FMU_MODEL_NAME));
     myc->instantiationToken=safe_strdup(instantiationToken,strdup(FMU_TOKEN));
     myc->resourcePath=safe_strdup(resourcePath,NULL);
@@ -281,24 +801,29 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
 
     myc->last_time=0.0;
 
-    myc->loggingCategories = calloc(2,sizeof(char*));
-    if (myc->loggingCategories != NULL) {
-        myc->nCategories = 2;
-        myc->loggingCategories[0] = strdup("FMI");
-        myc->loggingCategories[1] = strdup("BINARY");
-    }
+    myc->loggingCategoryMask = LOG_CATEGORIES_ALL;
+    update_perf_counters(myc);
+    myc->traceInstance = trace_attach(myc->instanceName);
+#ifdef PRIVATE_LOG_BINARY
+    myc->binaryLog = binary_log_open(FMU_MODEL_NAME,myc->instanceName,myc);
+#endif
 
     if (doInit(myc) != fmi3OK) {
         fmi_verbose_log_global("fmi3InstantiateCoSimulation(\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,...) = NULL (doInit failure)",
             instanceName, instantiationToken,
             (resourcePath != NULL) ? resourcePath : "<NULL>",
             visible, loggingOn, eventModeUsed, earlyReturnAllowed);
+#ifdef PRIVATE_LOG_BINARY
+        binary_log_close(myc->binaryLog);
+#endif
+        free(myc->perf);
+        trace_detach(myc->traceInstance);
         free(myc->resourcePath);
         free(myc->instantiationToken);
         free(myc->instanceName);
-        for (;myc->loggingCategories!=NULL && myc->nCategories>0;) free(myc->loggingCategories[--(myc->nCategories)]);
-        free(myc->loggingCategories);
         free(myc);
+        private_log_detach();
+        trace_end();
         return NULL;
     }
     fmi_verbose_log_global("fmi3InstantiateCoSimulation(\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,...) = %p",
@@ -307,6 +832,7 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
         visible, loggingOn, eventModeUsed, earlyReturnAllowed,
         myc);
 
+    trace_end();
     return (fmi3Instance)myc;
 }
 
@@ -318,34 +844,72 @@ FMI3_Export fmi3Status fmi3EnterInitializationMode(fmi3Instance instance,
     fmi3Float64 stopTime)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3EnterInitializationMode");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3EnterInitializationMode(%d,%g,%g,%d,%g)", toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime);
-    return doEnterInitializationMode(myc,toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime);
+    return trace_return(doEnterInitializationMode(myc,toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime));
 }
 
 FMI3_Export fmi3Status fmi3ExitInitializationMode(fmi3Instance instance)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3ExitInitializationMode");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3ExitInitializationMode()");
-    return doExitInitializationMode(myc);
+    return trace_return(doExitInitializationMode(myc));
 }
 
 FMI3_Export fmi3Status fmi3EnterConfigurationMode(fmi3Instance instance)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    trace_begin(myc->traceInstance,"fmi3EnterConfigurationMode");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3EnterConfigurationMode()");
     myc->reconfiguration_mode = 1;
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_ENTER_CONFIGURATION_MODE,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3ExitConfigurationMode(fmi3Instance instance)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    fmi3UInt64 x_size = myc->x_dimension_size, y_size = myc->y_dimension_size;
+    size_t size;
+    trace_begin(myc->traceInstance,"fmi3ExitConfigurationMode");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3ExitConfigurationMode()");
-    myc->float64_parameter = myrecalloc(myc->float64_parameter,myc->x_dimension_size*myc->y_dimension_size,sizeof(fmi3Float64));
-    myc->float64_input = myrecalloc(myc->float64_input,myc->x_dimension_size*myc->y_dimension_size,sizeof(fmi3Float64));
-    myc->float64_output = myrecalloc(myc->float64_output,myc->x_dimension_size*myc->y_dimension_size,sizeof(fmi3Float64));
+    if (x_size != 0 && y_size > (fmi3UInt64)((size_t)-1)/x_size) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Invalid array size %llu*%llu: Number of elements overflows.",(unsigned long long)x_size,(unsigned long long)y_size);
+        return trace_return(fmi3Error);
+    }
+    size = (size_t)(x_size*y_size);
+    if (size != myc->array_size) {
+        unbind_input(myc);
+        unbind_output(myc);
+    }
+    if (size > myc->array_capacity) {
+        if (grow_arena(myc,size) != fmi3OK) {
+            error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory resizing arrays to %zu elements.",size);
+            return trace_return(fmi3Error);
+        }
+    } else if (size > myc->array_size) {
+        /* Fits into existing buffers: only clear the newly exposed elements */
+        memset(myc->float64_parameter+myc->array_size,0,(size-myc->array_size)*sizeof(fmi3Float64));
+        memset(myc->float64_input+myc->array_size,0,(size-myc->array_size)*sizeof(fmi3Float64));
+        memset(myc->float64_output+myc->array_size,0,(size-myc->array_size)*sizeof(fmi3Float64));
+    }
+    if (size != myc->array_size) {
+        myc->array_generation++;
+        myc->output_generation++;
+    }
+    myc->array_size = size;
+    if (resolve_thread_count(myc) != myc->n_workers+1) {
+        stop_worker_pool(myc);
+        start_worker_pool(myc);
+    }
     myc->reconfiguration_mode = 0;
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_EXIT_CONFIGURATION_MODE,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3DoStep(fmi3Instance instance,
@@ -358,37 +922,54 @@ FMI3_Export fmi3Status fmi3DoStep(fmi3Instance instance,
                                   fmi3Float64* lastSuccessfulTime)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    trace_begin(myc->traceInstance,"fmi3DoStep");
+    probe_entry(myc,0,communicationStepSize);
     fmi_verbose_log(myc,"fmi3DoStep(%g,%g,%d,%p,%p,%p,%p)", currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
-    return doCalc(myc,currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+    return trace_return(perf_end(myc->perf,PERF_DO_STEP,perf_start,doCalc(myc,currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime)));
 }
 
 FMI3_Export fmi3Status fmi3Terminate(fmi3Instance instance)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3Terminate");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3Terminate()");
-    return doTerm(myc);
+    log_perf_counters(myc);
+    return trace_return(doTerm(myc));
 }
 
 FMI3_Export fmi3Status fmi3Reset(fmi3Instance instance)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3Reset");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3Reset()");
     doFree(myc);
-    return doInit(myc);
+    return trace_return(doInit(myc));
 }
 
 FMI3_Export void fmi3FreeInstance(fmi3Instance instance)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3FreeInstance");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3FreeInstance()");
     doFree(myc);
+    free_all_states(myc);
+    plan_free_all(&myc->plans);
 
+#ifdef PRIVATE_LOG_BINARY
+    binary_log_close(myc->binaryLog);
+#endif
+    free(myc->perf);
+    trace_end();
+    trace_detach(myc->traceInstance);
     free(myc->resourcePath);
     free(myc->instantiationToken);
     free(myc->instanceName);
-    for (;myc->loggingCategories!=NULL && myc->nCategories>0;) free(myc->loggingCategories[--(myc->nCategories)]);
-    free(myc->loggingCategories);
     free(myc);
+    private_log_detach();
 }
 
 /*
@@ -398,7 +979,10 @@ FMI3_Export void fmi3FreeInstance(fmi3Instance instance)
 FMI3_Export fmi3Status fmi3GetFloat64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Float64 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
-    size_t i,j,k,size;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    size_t i,j,size;
+    trace_begin(myc->traceInstance,"fmi3GetFloat64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetFloat64(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
@@ -407,46 +991,52 @@ FMI3_Export fmi3Status fmi3GetFloat64(fmi3Instance instance, const fmi3ValueRefe
                 break;
             case FMI_FLOAT64_PARAMETER_VR:
                 size=myc->x_dimension_size*myc->y_dimension_size;
-                for (k=0;k<size;k++)
-                    values[j++]=myc->float64_parameter[k];
+                memcpy(values+j,myc->float64_parameter,size*sizeof(fmi3Float64));
+                j+=size;
                 break;
             case FMI_FLOAT64_INPUT_VR:
                 size=myc->x_dimension_size*myc->y_dimension_size;
-                for (k=0;k<size;k++)
-                    values[j++]=myc->float64_input[k];
+                memcpy(values+j,myc->float64_input,size*sizeof(fmi3Float64));
+                j+=size;
                 break;
             case FMI_FLOAT64_OUTPUT_VR:
                 size=myc->x_dimension_size*myc->y_dimension_size;
-                for (k=0;k<size;k++)
-                    values[j++]=myc->float64_output[k];
+                memcpy(values+j,myc->float64_output,size*sizeof(fmi3Float64));
+                j+=size;
                 break;
             default:
-                error_log(instance,"Invalid value reference %zu for type FLOAT64: Must be 0, 3, 4, or 5.",valueReferences[i]);
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type FLOAT64: Must be 0, 3, 4, or 5.",valueReferences[i]);
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_FLOAT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetFloat32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Float32 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetFloat32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetFloat32(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_FLOAT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt64 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt64(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
@@ -456,433 +1046,1050 @@ FMI3_Export fmi3Status fmi3GetUInt64(fmi3Instance instance, const fmi3ValueRefer
             case FMI_UINT64_Y_SIZE_VR:
                 values[j++]=myc->y_dimension_size;
                 break;
+            case FMI_UINT64_THREADS_VR:
+                values[j++]=myc->threads;
+                break;
             default:
-                error_log(instance,"Invalid value reference %zu for type UINT64: Must be 1 or 2.",valueReferences[i]);
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type UINT64: Must be 1, 2, or 6.",valueReferences[i]);
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int64 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt64(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_INT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt32 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt32(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int32 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt32(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_INT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt16 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt16(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int16 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt16(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_INT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt8 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt8(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int8 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt8(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_INT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetBoolean(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Boolean values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetBoolean");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetBoolean(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_BOOLEAN,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetString(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3String values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetString");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetString(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_STRING,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetBinary(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, size_t valueSizes[], fmi3Binary values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetBinary");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetBinary(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_GET_BINARY,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetFloat64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Float64 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
-    size_t i,j,k,size;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    size_t i,j,size;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetFloat64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetFloat64(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             case FMI_FLOAT64_TIME_VR:
-                error_log(instance,"Cannot set independent variable directly.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_ARGUMENT,"Cannot set independent variable directly.");
+                return trace_return(fmi3Error);
             case FMI_FLOAT64_PARAMETER_VR:
                 size=myc->x_dimension_size*myc->y_dimension_size;
-                for (k=0;k<size;k++)
-                    myc->float64_parameter[k]=values[j++];
+                memcpy(myc->float64_parameter,values+j,size*sizeof(fmi3Float64));
+                j+=size;
                 break;
             case FMI_FLOAT64_INPUT_VR:
+                if (myc->input_buffer != NULL) {
+                    error_log(instance,FMI3X_ERROR_ARGUMENT,"Cannot set input bound to a host buffer.");
+                    return trace_return(fmi3Error);
+                }
                 size=myc->x_dimension_size*myc->y_dimension_size;
-                for (k=0;k<size;k++)
-                    myc->float64_input[k]=values[j++];
+                memcpy(myc->float64_input,values+j,size*sizeof(fmi3Float64));
+                j+=size;
                 break;
             case FMI_FLOAT64_OUTPUT_VR:
-                error_log(instance,"Cannot set output variable.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_ARGUMENT,"Cannot set output variable.");
+                return trace_return(fmi3Error);
             default:
-                error_log(instance,"Invalid value reference %zu for type FLOAT64: Must be 0, 3, 4, or 5.",valueReferences[i]);
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type FLOAT64: Must be 0, 3, 4, or 5.",valueReferences[i]);
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_FLOAT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetFloat32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Float32 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetFloat32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetFloat32(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_FLOAT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt64 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt64(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             case FMI_UINT64_X_SIZE_VR:
                 if (!myc->reconfiguration_mode) {
-                    error_log(instance,"Cannot set structural parameter outside (re-)configuration mode.");
-                    return fmi3Error;
+                    error_log(instance,FMI3X_ERROR_ARGUMENT,"Cannot set structural parameter outside (re-)configuration mode.");
+                    return trace_return(fmi3Error);
                 }
                 myc->x_dimension_size=values[j++];
                 break;
             case FMI_UINT64_Y_SIZE_VR:
                 if (!myc->reconfiguration_mode) {
-                    error_log(instance,"Cannot set structural parameter outside (re-)configuration mode.");
-                    return fmi3Error;
+                    error_log(instance,FMI3X_ERROR_ARGUMENT,"Cannot set structural parameter outside (re-)configuration mode.");
+                    return trace_return(fmi3Error);
                 }
                 myc->y_dimension_size=values[j++];
                 break;
+            case FMI_UINT64_THREADS_VR:
+                if (!myc->reconfiguration_mode) {
+                    error_log(instance,FMI3X_ERROR_ARGUMENT,"Cannot set structural parameter outside (re-)configuration mode.");
+                    return trace_return(fmi3Error);
+                }
+                if (values[j] > DYNAMIC_ARRAY_MAX_THREADS) {
+                    error_log(instance,FMI3X_ERROR_ARGUMENT,"Invalid number of threads %llu: Must be at most %d.",(unsigned long long)values[j],DYNAMIC_ARRAY_MAX_THREADS);
+                    return trace_return(fmi3Error);
+                }
+                myc->threads=values[j++];
+                break;
             default:
-                error_log(instance,"Invalid value reference %zu for type UINT64: Must be 1 or 2.",valueReferences[i]);
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type UINT64: Must be 1, 2, or 6.",valueReferences[i]);
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int64 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt64(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt32 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt32(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int32 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt32(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt16 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt16(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int16 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt16(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt8 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt8(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int8 values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt8(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetBoolean(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Boolean values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetBoolean");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetBoolean(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_BOOLEAN,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetString(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3String values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetString");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetString(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_STRING,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetBinary(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const size_t valueSizes[], const fmi3Binary values[], size_t nValues)
 {
     DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
     int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetBinary");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetBinary(...)");
     for (i = 0,j = 0; i<nValueReferences; i++) {
         switch (valueReferences[i]) {
             default:
-                error_log(instance,"Invalid accessor called, no variable of this type.");
-                return fmi3Error;
+                error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+                return trace_return(fmi3Error);
         }
     }
     if (myc->init_mode || tuned)
         doInitCalc(myc);
+    return trace_return(perf_end(myc->perf,PERF_SET_BINARY,perf_start,fmi3OK));
+}
+
+/*
+ * FMU State
+ */
+
+FMI3_Export fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    DynamicArrayTestState state;
+    trace_begin(myc->traceInstance,"fmi3GetFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3GetFMUState(%p)",*FMUState);
+    state = (*FMUState != NULL) ? (DynamicArrayTestState)*FMUState : acquire_state(myc);
+    if (state == NULL) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory allocating FMU state.");
+        return trace_return(fmi3Error);
+    }
+    if (state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p: State has already been freed.",(void*)state);
+        return trace_return(fmi3Error);
+    }
+    if (save_state(myc,state) != fmi3OK) {
+        if (*FMUState == NULL)
+            release_state(myc,state);
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory saving FMU state.");
+        return trace_return(fmi3Error);
+    }
+    *FMUState = (fmi3FMUState)state;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    DynamicArrayTestState state = (DynamicArrayTestState)FMUState;
+    trace_begin(myc->traceInstance,"fmi3SetFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3SetFMUState(%p)",FMUState);
+    if (state == NULL || state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p.",FMUState);
+        return trace_return(fmi3Error);
+    }
+    if (restore_state(myc,state) != fmi3OK) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory restoring FMU state.");
+        return trace_return(fmi3Error);
+    }
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    DynamicArrayTestState state;
+    trace_begin(myc->traceInstance,"fmi3FreeFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3FreeFMUState(%p)",(FMUState != NULL) ? *FMUState : NULL);
+    if (FMUState == NULL || *FMUState == NULL)
+        return trace_return(fmi3OK);
+    state = (DynamicArrayTestState)*FMUState;
+    if (state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p: State has already been freed.",(void*)state);
+        return trace_return(fmi3Error);
+    }
+    release_state(myc,state);
+    *FMUState = NULL;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance, fmi3FMUState FMUState, size_t *size)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    DynamicArrayTestState state = (DynamicArrayTestState)FMUState;
+    trace_begin(myc->traceInstance,"fmi3SerializedFMUStateSize");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3SerializedFMUStateSize(%p)",FMUState);
+    if (state == NULL || state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p.",FMUState);
+        return trace_return(fmi3Error);
+    }
+    *size = serialized_state_size(state);
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3SerializeFMUState(fmi3Instance instance, fmi3FMUState FMUState, fmi3Byte serializedState[], size_t size)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    DynamicArrayTestState state = (DynamicArrayTestState)FMUState;
+    size_t needed;
+    trace_begin(myc->traceInstance,"fmi3SerializeFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3SerializeFMUState(%p,%p,%zu)",FMUState,serializedState,size);
+    if (state == NULL || state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p.",FMUState);
+        return trace_return(fmi3Error);
+    }
+    needed = serialized_state_size(state);
+    if (size < needed) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Buffer of %zu bytes too small for serialized FMU state of %zu bytes.",size,needed);
+        return trace_return(fmi3Error);
+    }
+    serialize_state(state,serializedState);
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3DeserializeFMUState(fmi3Instance instance, const fmi3Byte serializedState[], size_t size, fmi3FMUState* FMUState)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    DynamicArrayTestState state, previous = (DynamicArrayTestState)*FMUState;
+    trace_begin(myc->traceInstance,"fmi3DeserializeFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3DeserializeFMUState(%p,%zu,%p)",serializedState,size,*FMUState);
+    if (previous != NULL && previous->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p: State has already been freed.",(void*)previous);
+        return trace_return(fmi3Error);
+    }
+    /* Into a fresh snapshot, so that a bad blob leaves the host's state intact */
+    state = acquire_state(myc);
+    if (state == NULL) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory allocating FMU state.");
+        return trace_return(fmi3Error);
+    }
+    if (!deserialize_state(state,serializedState,size)) {
+        release_state(myc,state);
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid serialized FMU state of %zu bytes.",size);
+        return trace_return(fmi3Error);
+    }
+    if (previous != NULL)
+        release_state(myc,previous);
+    *FMUState = (fmi3FMUState)state;
+    return trace_return(fmi3OK);
+}
+
+/*
+ * Partial Derivatives
+ *
+ * Float64Output is the elementwise product of Float64Input and
+ * Float64Parameter, so its Jacobian with respect to either of them is
+ * diagonal and both the directional and the adjoint derivative reduce
+ * to elementwise products with the other factor.  Unknowns and knowns
+ * may be given repeatedly; each occurrence covers XSize*YSize values.
+ * As an extension several seed vectors can be passed in one call by
+ * concatenating them in seed, in which case the sensitivities for all
+ * of them are returned concatenated in the same order.
+ */
+
+/* Diagonal of the Jacobian of Float64Output with respect to a known */
+static const fmi3Float64* derivative_diagonal(DynamicArrayTest component, fmi3ValueReference known)
+{
+    switch (known) {
+        case FMI_FLOAT64_PARAMETER_VR:
+            return component->float64_input;
+        case FMI_FLOAT64_INPUT_VR:
+            return component->float64_parameter;
+        default:
+            error_log(component,FMI3X_ERROR_VALUE_REFERENCE,"Invalid known value reference %zu: Must be 3 or 4.",(size_t)known);
+            return NULL;
+    }
+}
+
+static fmi3Status check_derivative_arguments(DynamicArrayTest component,
+                                             const fmi3ValueReference unknowns[], size_t nUnknowns,
+                                             const fmi3ValueReference knowns[], size_t nKnowns,
+                                             size_t seed_length, size_t nSeed,
+                                             size_t sensitivity_length, size_t nSensitivity,
+                                             size_t* vectors)
+{
+    size_t i;
+    for (i = 0; i<nUnknowns; i++) {
+        if (unknowns[i] != FMI_FLOAT64_OUTPUT_VR) {
+            error_log(component,FMI3X_ERROR_VALUE_REFERENCE,"Invalid unknown value reference %zu: Must be 5.",(size_t)unknowns[i]);
+            return fmi3Error;
+        }
+    }
+    for (i = 0; i<nKnowns; i++)
+        if (derivative_diagonal(component,knowns[i]) == NULL)
+            return fmi3Error;
+    if (seed_length > 0)
+        *vectors = nSeed / seed_length;
+    else if (sensitivity_length > 0)
+        *vectors = nSensitivity / sensitivity_length;
+    else
+        *vectors = 0;
+    if (nSeed != *vectors*seed_length || nSensitivity != *vectors*sensitivity_length) {
+        error_log(component,FMI3X_ERROR_ARGUMENT,"Invalid number of seed (%zu) or sensitivity (%zu) values: Must be multiples of %zu and %zu.",
+            nSeed,nSensitivity,seed_length,sensitivity_length);
+        return fmi3Error;
+    }
     return fmi3OK;
 }
 
+FMI3_Export fmi3Status fmi3GetDirectionalDerivative(fmi3Instance instance,
+                                                    const fmi3ValueReference unknowns[],
+                                                    size_t nUnknowns,
+                                                    const fmi3ValueReference knowns[],
+                                                    size_t nKnowns,
+                                                    const fmi3Float64 seed[],
+                                                    size_t nSeed,
+                                                    fmi3Float64 sensitivity[],
+                                                    size_t nSensitivity)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    size_t size = myc->array_size;
+    size_t vectors, v, i;
+    trace_begin(myc->traceInstance,"fmi3GetDirectionalDerivative");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3GetDirectionalDerivative(%zu,%zu,%zu,%zu)",nUnknowns,nKnowns,nSeed,nSensitivity);
+    if (check_derivative_arguments(myc,unknowns,nUnknowns,knowns,nKnowns,nKnowns*size,nSeed,nUnknowns*size,nSensitivity,&vectors) != fmi3OK)
+        return trace_return(fmi3Error);
+    if (size == 0 || nUnknowns == 0)
+        return trace_return(fmi3OK);
+    for (v = 0; v<vectors; v++) {
+        const fmi3Float64* vector = seed + v*nKnowns*size;
+        fmi3Float64* result = sensitivity + v*nUnknowns*size;
+        if (nKnowns == 0)
+            memset(result,0,size*sizeof(fmi3Float64));
+        for (i = 0; i<nKnowns; i++) {
+            if (i == 0)
+                myc->multiply(result,derivative_diagonal(myc,knowns[i]),vector,size);
+            else
+                myc->multiply_add(result,derivative_diagonal(myc,knowns[i]),vector+i*size,size);
+        }
+        for (i = 1; i<nUnknowns; i++)
+            memcpy(result+i*size,result,size*sizeof(fmi3Float64));
+    }
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3GetAdjointDerivative(fmi3Instance instance,
+                                                const fmi3ValueReference unknowns[],
+                                                size_t nUnknowns,
+                                                const fmi3ValueReference knowns[],
+                                                size_t nKnowns,
+                                                const fmi3Float64 seed[],
+                                                size_t nSeed,
+                                                fmi3Float64 sensitivity[],
+                                                size_t nSensitivity)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    size_t size = myc->array_size;
+    size_t vectors, v, i, k;
+    trace_begin(myc->traceInstance,"fmi3GetAdjointDerivative");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3GetAdjointDerivative(%zu,%zu,%zu,%zu)",nUnknowns,nKnowns,nSeed,nSensitivity);
+    if (check_derivative_arguments(myc,unknowns,nUnknowns,knowns,nKnowns,nUnknowns*size,nSeed,nKnowns*size,nSensitivity,&vectors) != fmi3OK)
+        return trace_return(fmi3Error);
+    if (size == 0 || nKnowns == 0)
+        return trace_return(fmi3OK);
+    for (v = 0; v<vectors; v++) {
+        const fmi3Float64* vector = seed + v*nUnknowns*size;
+        fmi3Float64* result = sensitivity + v*nKnowns*size;
+        for (k = 0; k<nKnowns; k++) {
+            const fmi3Float64* diagonal = derivative_diagonal(myc,knowns[k]);
+            fmi3Float64* row = result + k*size;
+            if (nUnknowns == 0)
+                memset(row,0,size*sizeof(fmi3Float64));
+            for (i = 0; i<nUnknowns; i++) {
+                if (i == 0)
+                    myc->multiply(row,diagonal,vector,size);
+                else
+                    myc->multiply_add(row,diagonal,vector+i*size,size);
+            }
+        }
+    }
+    return trace_return(fmi3OK);
+}
+
 /*
- * Unsupported Features (FMUState, Derivatives, Status Enquiries)
+ * Vendor Extensions
  */
 
-#define unsupported(x) { error_log(instance,"Unsupported function %s called!",#x); return fmi3Error; }
+FMI3_Export fmi3Status fmi3xGetErrorCounts(fmi3Instance instance, fmi3UInt64 counts[], size_t nCounts)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    size_t i;
+    trace_begin(myc->traceInstance,"fmi3xGetErrorCounts");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3xGetErrorCounts(...)");
+    for (i = 0; i<nCounts; i++)
+        counts[i] = (i < FMI3X_ERROR_KINDS) ? myc->errorCounts[i] : 0;
+    return trace_return(fmi3OK);
+}
+
+/*
+ * Prepared Access
+ *
+ * Value references are checked as by the accessors.  The arrays are
+ * covered with their current size, so plans remember the generation
+ * of the arrays and refuse to run once they were resized.  Structural
+ * parameters are only set through fmi3SetUInt64, which checks them.
+ */
+
+/* Check the value references, and add their storage to plan unless NULL */
+static fmi3Status compile_plan(DynamicArrayTest component, fmi3xAccessPlan plan, int type, fmi3Boolean set, const fmi3ValueReference valueReferences[], size_t nValueReferences)
+{
+    size_t i;
+    if (type < FMI3X_TYPE_FLOAT32 || type > FMI3X_TYPE_BOOLEAN) {
+        error_log(component,FMI3X_ERROR_ARGUMENT,"Invalid type %d for prepared access.",type);
+        return fmi3Error;
+    }
+    for (i = 0; i<nValueReferences; i++) {
+        if (type == FMI3X_TYPE_FLOAT64) {
+            switch (valueReferences[i]) {
+                case FMI_FLOAT64_TIME_VR:
+                    if (set) {
+                        error_log(component,FMI3X_ERROR_ARGUMENT,"Cannot set independent variable directly.");
+                        return fmi3Error;
+                    }
+                    if (plan != NULL)
+                        plan_add(plan,&component->last_time,1,sizeof(component->last_time));
+                    continue;
+                case FMI_FLOAT64_PARAMETER_VR:
+                    if (plan != NULL)
+                        plan_add(plan,component->float64_parameter,component->array_size,sizeof(fmi3Float64));
+                    continue;
+                case FMI_FLOAT64_INPUT_VR:
+                    if (set && component->input_buffer != NULL) {
+                        error_log(component,FMI3X_ERROR_ARGUMENT,"Cannot set input bound to a host buffer.");
+                        return fmi3Error;
+                    }
+                    if (plan != NULL)
+                        plan_add(plan,component->float64_input,component->array_size,sizeof(fmi3Float64));
+                    continue;
+                case FMI_FLOAT64_OUTPUT_VR:
+                    if (set) {
+                        error_log(component,FMI3X_ERROR_ARGUMENT,"Cannot set output variable.");
+                        return fmi3Error;
+                    }
+                    if (plan != NULL)
+                        plan_add(plan,component->float64_output,component->array_size,sizeof(fmi3Float64));
+                    continue;
+                default:
+                    error_log(component,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type FLOAT64: Must be 0, 3, 4, or 5.",(size_t)valueReferences[i]);
+                    return fmi3Error;
+            }
+        } else if (type == FMI3X_TYPE_UINT64) {
+            fmi3UInt64* value;
+            switch (valueReferences[i]) {
+                case FMI_UINT64_X_SIZE_VR:
+                    value = &component->x_dimension_size;
+                    break;
+                case FMI_UINT64_Y_SIZE_VR:
+                    value = &component->y_dimension_size;
+                    break;
+                case FMI_UINT64_THREADS_VR:
+                    value = &component->threads;
+                    break;
+                default:
+                    error_log(component,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type UINT64: Must be 1, 2, or 6.",(size_t)valueReferences[i]);
+                    return fmi3Error;
+            }
+            if (set) {
+                error_log(component,FMI3X_ERROR_ARGUMENT,"Cannot set structural parameter by prepared access, use fmi3SetUInt64.");
+                return fmi3Error;
+            }
+            if (plan != NULL)
+                plan_add(plan,value,1,sizeof(*value));
+        } else {
+            error_log(component,FMI3X_ERROR_VALUE_REFERENCE,"Invalid accessor called, no variable of this type.");
+            return fmi3Error;
+        }
+    }
+    return fmi3OK;
+}
+
+static FMU_INLINE const char* check_plan(DynamicArrayTest component, fmi3xAccessPlan plan, fmi3Boolean set, size_t nValues)
+{
+    const char* problem = plan_check(component,plan,set,nValues);
+    if (problem == NULL && plan->generation != component->array_generation)
+        problem = "Prepared access plan is stale: The arrays were resized or moved since it was prepared.";
+    return problem;
+}
+
+FMI3_Export fmi3Status fmi3xPrepareAccess(fmi3Instance instance, int type, fmi3Boolean set, const fmi3ValueReference valueReferences[], size_t nValueReferences, size_t* nValues, fmi3xAccessPlan* plan)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xPrepareAccess");
+    probe_entry(myc,nValueReferences,0.0);
+    fmi_verbose_log(myc,"fmi3xPrepareAccess(%d,%d,...)",type,set);
+    *plan = NULL;
+    if (compile_plan(myc,NULL,type,set,valueReferences,nValueReferences) != fmi3OK)
+        return trace_return(fmi3Error);
+    *plan = plan_alloc(myc,set,nValueReferences);
+    if (*plan == NULL) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory preparing access to %zu value references.",nValueReferences);
+        return trace_return(fmi3Error);
+    }
+    compile_plan(myc,*plan,type,set,valueReferences,nValueReferences);
+    (*plan)->generation = myc->array_generation;
+    plan_link(&myc->plans,*plan);
+    if (nValues != NULL)
+        *nValues = (*plan)->nValues;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3xGetPrepared(fmi3Instance instance, fmi3xAccessPlan plan, void* values, size_t nValues)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    const char* problem;
+    trace_begin(myc->traceInstance,"fmi3xGetPrepared");
+    probe_entry(myc,nValues,0.0);
+    fmi_verbose_log(myc,"fmi3xGetPrepared(%p,...)",(void*)plan);
+    problem = check_plan(myc,plan,fmi3False,nValues);
+    if (problem != NULL) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"%s",problem);
+        return trace_return(fmi3Error);
+    }
+    plan_get(plan,values);
+    return trace_return(perf_end(myc->perf,PERF_GET_PREPARED,perf_start,fmi3OK));
+}
+
+FMI3_Export fmi3Status fmi3xSetPrepared(fmi3Instance instance, fmi3xAccessPlan plan, const void* values, size_t nValues)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    const char* problem;
+    trace_begin(myc->traceInstance,"fmi3xSetPrepared");
+    probe_entry(myc,nValues,0.0);
+    fmi_verbose_log(myc,"fmi3xSetPrepared(%p,...)",(void*)plan);
+    problem = check_plan(myc,plan,fmi3True,nValues);
+    if (problem != NULL) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"%s",problem);
+        return trace_return(fmi3Error);
+    }
+    plan_set(plan,values);
+    if (myc->init_mode)
+        doInitCalc(myc);
+    return trace_return(perf_end(myc->perf,PERF_SET_PREPARED,perf_start,fmi3OK));
+}
+
+FMI3_Export fmi3Status fmi3xFreePrepared(fmi3Instance instance, fmi3xAccessPlan plan)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xFreePrepared");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3xFreePrepared(%p)",(void*)plan);
+    if (plan != NULL && !plan_free(&myc->plans,plan)) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Invalid prepared access plan %p: Not prepared by this instance.",(void*)plan);
+        return trace_return(fmi3Error);
+    }
+    return trace_return(fmi3OK);
+}
+
+/*
+ * Shared Arrays
+ *
+ * Buffers cannot be bound in configuration mode, where the size the
+ * arrays will have is not known yet.
+ */
+
+FMI3_Export fmi3Status fmi3xBorrowFloat64Output(fmi3Instance instance, fmi3ValueReference valueReference, const fmi3Float64** values, size_t* nValues, fmi3UInt64* generation)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xBorrowFloat64Output");
+    probe_entry(myc,1,0.0);
+    fmi_verbose_log(myc,"fmi3xBorrowFloat64Output(%u,...)",(unsigned int)valueReference);
+    if (valueReference != FMI_FLOAT64_OUTPUT_VR) {
+        error_log(myc,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for borrowing: Must be 5.",(size_t)valueReference);
+        return trace_return(fmi3Error);
+    }
+    *values = myc->float64_output;
+    if (nValues != NULL)
+        *nValues = myc->array_size;
+    if (generation != NULL)
+        *generation = myc->output_generation;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3xBindFloat64Output(fmi3Instance instance, fmi3ValueReference valueReference, fmi3Float64 buffer[], size_t nValues)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xBindFloat64Output");
+    probe_entry(myc,1,0.0);
+    fmi_verbose_log(myc,"fmi3xBindFloat64Output(%u,%p,%zu)",(unsigned int)valueReference,(void*)buffer,nValues);
+    if (valueReference != FMI_FLOAT64_OUTPUT_VR) {
+        error_log(myc,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for binding: Must be 5.",(size_t)valueReference);
+        return trace_return(fmi3Error);
+    }
+    if (buffer == NULL) {
+        unbind_output(myc);
+        return trace_return(fmi3OK);
+    }
+    if (myc->reconfiguration_mode) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Cannot bind output buffer in configuration mode.");
+        return trace_return(fmi3Error);
+    }
+    if (nValues != myc->array_size) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Output buffer of %zu values does not match the output size of %zu values.",nValues,myc->array_size);
+        return trace_return(fmi3Error);
+    }
+    if (buffer != myc->output_buffer) {
+        memcpy(buffer,myc->float64_output,myc->array_size*sizeof(fmi3Float64));
+        myc->float64_output = buffer;
+        myc->output_buffer = buffer;
+        myc->array_generation++;
+        myc->output_generation++;
+    }
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3xBindFloat64Input(fmi3Instance instance, fmi3ValueReference valueReference, const fmi3Float64 buffer[], size_t nValues)
+{
+    DynamicArrayTest myc = (DynamicArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xBindFloat64Input");
+    probe_entry(myc,1,0.0);
+    fmi_verbose_log(myc,"fmi3xBindFloat64Input(%u,%p,%zu)",(unsigned int)valueReference,(const void*)buffer,nValues);
+    if (valueReference != FMI_FLOAT64_INPUT_VR) {
+        error_log(myc,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for binding: Must be 4.",(size_t)valueReference);
+        return trace_return(fmi3Error);
+    }
+    if (buffer == NULL) {
+        unbind_input(myc);
+        return trace_return(fmi3OK);
+    }
+    if (myc->reconfiguration_mode) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Cannot bind input buffer in configuration mode.");
+        return trace_return(fmi3Error);
+    }
+    if (nValues != myc->array_size) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Input buffer of %zu values does not match the input size of %zu values.",nValues,myc->array_size);
+        return trace_return(fmi3Error);
+    }
+    if (buffer != myc->input_buffer) {
+        /* Never written through, see Shared Arrays above */
+        myc->float64_input = (fmi3Float64*)buffer;
+        myc->input_buffer = buffer;
+        myc->array_generation++;
+    }
+    return trace_return(fmi3OK);
+}
+
+/*
+ * Unsupported Features (Derivatives, Status Enquiries)
+ */
+
+#define unsupported(x) { trace_begin(((DynamicArrayTest)instance)->traceInstance,#x); probe_entry(instance,0,0.0); error_log(instance,FMI3X_ERROR_UNSUPPORTED,"Unsupported function %s called!",#x); return trace_return(fmi3Error); }
 
 FMI3_Export fmi3Status fmi3GetClock(fmi3Instance instance,
                                     const fmi3ValueReference valueReferences[],
@@ -964,38 +2171,6 @@ FMI3_Export fmi3Status fmi3GetVariableDependencies(fmi3Instance instance,
                                                    fmi3DependencyKind dependencyKinds[],
                                                    size_t nDependencies) unsupported(fmi3GetVariableDependencies)
 
-FMI3_Export fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState) unsupported(fmi3GetFMUState)
-
-FMI3_Export fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState) unsupported(fmi3SetFMUState)
-
-FMI3_Export fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState) unsupported(fmi3FreeFMUState)
-
-FMI3_Export fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance, fmi3FMUState FMUState, size_t *size) unsupported(fmi3SerializedFMUStateSize)
-
-FMI3_Export fmi3Status fmi3SerializeFMUState(fmi3Instance instance, fmi3FMUState FMUState, fmi3Byte serializedState[], size_t size) unsupported(fmi3SerializeFMUState)
-
-FMI3_Export fmi3Status fmi3DeserializeFMUState(fmi3Instance instance, const fmi3Byte serializedState[], size_t size, fmi3FMUState* FMUState) unsupported(fmi3DeserializeFMUState)
-
-FMI3_Export fmi3Status fmi3GetDirectionalDerivative(fmi3Instance instance,
-                                                    const fmi3ValueReference unknowns[],
-                                                    size_t nUnknowns,
-                                                    const fmi3ValueReference knowns[],
-                                                    size_t nKnowns,
-                                                    const fmi3Float64 seed[],
-                                                    size_t nSeed,
-                                                    fmi3Float64 sensitivity[],
-                                                    size_t nSensitivity) unsupported(fmi3GetDirectionalDerivative)
-
-FMI3_Export fmi3Status fmi3GetAdjointDerivative(fmi3Instance instance,
-                                                const fmi3ValueReference unknowns[],
-                                                size_t nUnknowns,
-                                                const fmi3ValueReference knowns[],
-                                                size_t nKnowns,
-                                                const fmi3Float64 seed[],
-                                                size_t nSeed,
-                                                fmi3Float64 sensitivity[],
-                                                size_t nSensitivity) unsupported(fmi3GetAdjointDerivative)
-
 FMI3_Export fmi3Status fmi3GetOutputDerivatives(fmi3Instance instance,
                                                 const fmi3ValueReference valueReferences[],
                                                 size_t nValueReferences,
@@ -1016,8 +2191,11 @@ FMI3_Export fmi3Instance fmi3InstantiateModelExchange(
     fmi3InstanceEnvironment    instanceEnvironment,
     fmi3LogMessageCallback     logMessage)
 {
+    trace_begin(0,"fmi3InstantiateModelExchange");
+    probe_entry(NULL,0,0.0);
     if (loggingOn && logMessage)
         logMessage(instanceEnvironment,fmi3Error,"FMI","Unsupported function fmi3InstantateModelExchange called!");
+    trace_end();
     return NULL;
 }
 
@@ -1033,8 +2211,11 @@ FMI3_Export fmi3Instance fmi3InstantiateScheduledExecution(
     fmi3LockPreemptionCallback     lockPreemption,
     fmi3UnlockPreemptionCallback   unlockPreemption)
 {
+    trace_begin(0,"fmi3InstantiateScheduledExecution");
+    probe_entry(NULL,0,0.0);
     if (loggingOn && logMessage)
         logMessage(instanceEnvironment,fmi3Error,"FMI","Unsupported function fmi3InstantateScheduledExecution called!");
+    trace_end();
     return NULL;
 }
 
@@ -23,6 +23,8 @@
 #define FMI3_FUNCTION_PREFIX FMU_MODEL_IDENTIFIER ## _
 #endif
 #include "fmi3Functions.h"
+#include "VendorExtensions.h"
+#include "ThreadUtil.h"
 
 typedef fmi3Byte* my3Binary;
 typedef fmi3Char* my3String;
@@ -38,6 +40,10 @@ typedef fmi3Char* my3String;
  *   the FMI logging facility where appropriate.
  * - If VERBOSE_FMI_LOGGING is defined then logging of basic
  *   FMI calls is enabled, which can get very verbose.
+ *
+ * If PRIVATE_LOG_BINARY is defined in addition to PRIVATE_LOG_PATH,
+ * instance messages are recorded unformatted into a binary log file
+ * for offline decoding instead (see BinaryLog.h).
  */
 
 /* Callbacks without const */
@@ -53,6 +59,46 @@ typedef struct {
 #define FMI_FLOAT64_PARAMETER_VR    3
 #define FMI_FLOAT64_INPUT_VR        4
 #define FMI_FLOAT64_OUTPUT_VR       5
+#define FMI_UINT64_THREADS_VR       6
+
+/*
+ * Multi-threaded Calculation
+ *
+ * The elementwise product in doCalc is split across a worker pool
+ * owned by the instance once the arrays hold at least
+ * DYNAMIC_ARRAY_PARALLEL_THRESHOLD elements; smaller arrays are always
+ * calculated on the calling thread.  The number of threads (including
+ * the calling thread) is given by the Threads structural parameter,
+ * or, if that is 0, by the DYNAMIC_ARRAY_TEST_THREADS environment
+ * variable, defaulting to 1 (no worker threads).
+ */
+#ifndef DYNAMIC_ARRAY_PARALLEL_THRESHOLD
+#define DYNAMIC_ARRAY_PARALLEL_THRESHOLD 131072
+#endif
+#define DYNAMIC_ARRAY_MAX_THREADS 256
+#define DYNAMIC_ARRAY_THREADS_ENV "DYNAMIC_ARRAY_TEST_THREADS"
+
+/* Elementwise product kernel: output[i] = a[i] * b[i] */
+typedef void (*fmi3Float64MultiplyKernel)(fmi3Float64* output, const fmi3Float64* a, const fmi3Float64* b, size_t size);
+
+/* Worker Thread */
+typedef struct DynamicArrayTestWorker {
+    struct DynamicArrayTest* component;
+    size_t index;
+    fmu_thread thread;
+} DynamicArrayTestWorker;
+
+/* FMU State Snapshot */
+typedef struct DynamicArrayTestState {
+    struct DynamicArrayTestState* next_free;
+    struct DynamicArrayTestState* next_allocated;
+    fmi3Boolean pooled;
+    fmi3UInt64 x_dimension_size;
+    fmi3UInt64 y_dimension_size;
+    fmi3Float64* arrays;
+    size_t capacity;
+    double last_time;
+} *DynamicArrayTestState;
 
 /* FMU Instance */
 typedef struct DynamicArrayTest {
@@ -64,15 +110,41 @@ typedef struct DynamicArrayTest {
     fmi3Boolean loggingOn;
     fmi3Boolean eventModeUsed;
     fmi3Boolean earlyReturnAllowed;
-    size_t nCategories;
-    char** loggingCategories;
+    unsigned int loggingCategoryMask;
+    fmi3UInt64 errorCounts[FMI3X_ERROR_KINDS];
+    struct PerfCounters* perf;
+    size_t traceInstance;
+#ifdef PRIVATE_LOG_BINARY
+    struct BinaryLog* binaryLog;
+#endif
     fmi3CallbackFunctionsVar functions;
     fmi3UInt64 x_dimension_size;
     fmi3UInt64 y_dimension_size;
+    fmi3Float64* arena;
     fmi3Float64* float64_parameter;
     fmi3Float64* float64_input;
     fmi3Float64* float64_output;
+    size_t array_size;
+    size_t array_capacity;
+    fmi3UInt64 array_generation;
+    const fmi3Float64* input_buffer;
+    fmi3Float64* output_buffer;
+    fmi3UInt64 output_generation;
+    fmi3Float64MultiplyKernel multiply;
+    fmi3Float64MultiplyKernel multiply_add;
+    fmi3UInt64 threads;
+    size_t n_workers;
+    DynamicArrayTestWorker* workers;
+    fmu_mutex pool_mutex;
+    fmu_cond pool_start;
+    fmu_cond pool_done;
+    unsigned long pool_generation;
+    size_t pool_pending;
+    int pool_shutdown;
     double last_time;
     fmi3Boolean init_mode;
     fmi3Boolean reconfiguration_mode;
+    DynamicArrayTestState free_states;
+    DynamicArrayTestState allocated_states;
+    fmi3xAccessPlan plans;
 } *DynamicArrayTest;
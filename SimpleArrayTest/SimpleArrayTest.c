@@ -12,9 +12,11 @@
 #include "CommonUtil.h"
 
 /* Private File-based Logging just for Debugging */
-#ifdef PRIVATE_LOG_PATH
-static FILE* private_log_file = NULL;
-#endif
+#include "PrivateLog.h"
+#include "BinaryLog.h"
+#include "UsdtProbes.h"
+#include "TraceEvents.h"
+#include "AccessPlan.h"
 
 void fmi_verbose_log_global(const char* format, ...)
 {
@@ -22,49 +24,38 @@ void fmi_verbose_log_global(const char* format, ...)
 #ifdef PRIVATE_LOG_PATH
     va_list ap;
     va_start(ap, format);
-    if (private_log_file == NULL)
-        private_log_file = fopen(PRIVATE_LOG_PATH,"a");
-    if (private_log_file != NULL) {
-        fprintf(private_log_file,"SimpleArrayTest::Global: ");
-        vfprintf(private_log_file, format, ap);
-        fputc('\n',private_log_file);
-        fflush(private_log_file);
-    }
+    private_log_vprintf("SimpleArrayTest::Global: ",format,ap);
+    va_end(ap);
 #endif
 #endif
 }
 
-void internal_log(SimpleArrayTest component,const char* category, const char* format, va_list arg)
+void internal_log(SimpleArrayTest component, unsigned int category, const char* format, va_list arg)
 {
-#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
+#ifdef PRIVATE_LOG_BINARY
+    va_list binary_arg;
+    va_copy(binary_arg, arg);
+    binary_log_vrecord(component->binaryLog,category,format,binary_arg);
+    va_end(binary_arg);
+#endif
+#if (defined(PRIVATE_LOG_PATH) && !defined(PRIVATE_LOG_BINARY)) || defined(PUBLIC_LOGGING)
     char buffer[1024];
+#if !defined(PRIVATE_LOG_PATH) || defined(PRIVATE_LOG_BINARY)
+    if (!component->loggingOn || !(component->loggingCategoryMask & category))
+        return;
+#endif
 #ifdef _WIN32
     vsnprintf_s(buffer, 1024, _TRUNCATE, format, arg);
 #else
     vsnprintf(buffer, 1024, format, arg);
     buffer[1023]='\0';
 #endif
-#ifdef PRIVATE_LOG_PATH
-    if (private_log_file == NULL)
-        private_log_file = fopen(PRIVATE_LOG_PATH,"a");
-    if (private_log_file != NULL) {
-        fprintf(private_log_file,"SimpleArrayTest::%s<%p>: %s\n",component->instanceName,component,buffer);
-        fflush(private_log_file);
-    }
+#if defined(PRIVATE_LOG_PATH) && !defined(PRIVATE_LOG_BINARY)
+    private_log_printf("SimpleArrayTest::%s<%p>: %s",component->instanceName,component,buffer);
 #endif
 #ifdef PUBLIC_LOGGING
-    if (component->loggingOn) {
-        size_t i;
-        int active = component->nCategories == 0;
-        for (i=0;i<component->nCategories;i++) {
-            if (0==strcmp(category,component->loggingCategories[i])) {
-                active = 1;
-                break;
-            }
-        }
-        if (active)
-            component->functions.logMessage(component->functions.instanceEnvironment,fmi3OK,category,buffer);
-    }
+    if (component->loggingOn && (component->loggingCategoryMask & category))
+        component->functions.logMessage(component->functions.instanceEnvironment,fmi3OK,log_category_name(category),buffer);
 #endif
 #endif
 }
@@ -74,13 +65,13 @@ void fmi_verbose_log(SimpleArrayTest component,const char* format, ...)
 #if defined(VERBOSE_FMI_LOGGING) && (defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING))
     va_list ap;
     va_start(ap, format);
-    internal_log(component,"FMI",format,ap);
+    internal_log(component,LOG_CATEGORY_FMI,format,ap);
     va_end(ap);
 #endif
 }
 
 /* Normal Logging */
-void normal_log(SimpleArrayTest component, const char* category, const char* format, ...) {
+void normal_log(SimpleArrayTest component, unsigned int category, const char* format, ...) {
 #if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
     va_list ap;
     va_start(ap, format);
@@ -90,29 +81,41 @@ void normal_log(SimpleArrayTest component, const char* category, const char* for
 }
 
 /* Mandatory Error Logging */
-void error_log(SimpleArrayTest component, const char* format, ...) {
+void error_log(SimpleArrayTest component, unsigned int kind, const char* format, ...) {
     va_list ap;
-    va_start(ap, format);
     char buffer[1024];
+    component->errorCounts[kind]++;
+    if (!component->loggingOn || !component->functions.logMessage || !(component->loggingCategoryMask & LOG_CATEGORY_FMI))
+        return;
+    va_start(ap, format);
 #ifdef _WIN32
     vsnprintf_s(buffer, 1024, _TRUNCATE, format, ap);
 #else
     vsnprintf(buffer, 1024, format, ap);
     buffer[1023]='\0';
 #endif
-    if (component->loggingOn && component->functions.logMessage) {
-        size_t i;
-        int active = component->nCategories == 0;
-        for (i=0;i<component->nCategories;i++) {
-            if (0==strcmp("FMI",component->loggingCategories[i])) {
-                active = 1;
-                break;
-            }
-        }
-        if (active)
-            component->functions.logMessage(component->functions.instanceEnvironment,fmi3Error,"FMI",buffer);
-    }
     va_end(ap);
+    component->functions.logMessage(component->functions.instanceEnvironment,fmi3Error,"FMI",buffer);
+}
+
+/* Performance Counters, counting while the PERF category is logged */
+void update_perf_counters(SimpleArrayTest component)
+{
+#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
+    if (!perf_activate(&component->perf,component->loggingOn && (component->loggingCategoryMask & LOG_CATEGORY_PERF)))
+        error_log(component,FMI3X_ERROR_MEMORY,"Out of memory allocating performance counters.");
+#endif
+}
+
+void log_perf_counters(SimpleArrayTest component)
+{
+#if defined(PRIVATE_LOG_PATH) || defined(PUBLIC_LOGGING)
+    char buffer[1024];
+    int function;
+    for (function = 0; function<PERF_FUNCTIONS; function++)
+        if (perf_format(component->perf,(PerfFunction)function,buffer,sizeof(buffer)))
+            normal_log(component,LOG_CATEGORY_PERF,"%s",buffer);
+#endif
 }
 
 /*
@@ -121,31 +124,30 @@ void error_log(SimpleArrayTest component, const char* format, ...) {
 
 #define FMI_BOOLEAN_XOR(a,b) ((a) ? (!(b)) : (b))
 
-#define CopyOut(a,i,b) do { \
-                         a[i++] = b[0][0]; \
-                         a[i++] = b[0][1]; \
-                         a[i++] = b[0][2]; \
-                         a[i++] = b[1][0]; \
-                         a[i++] = b[1][1]; \
-                         a[i++] = b[1][2]; \
+/* Copy the first n values of b (1 for the time, else all) as one block */
+#define CopyOut(a,i,b,n) do { \
+                         if ((n) == 1) \
+                             a[i] = b[0][0]; \
+                         else \
+                             memcpy(&a[i],b,sizeof(b)); \
+                         i += (n); \
                        } while(0)
 
-#define CopyIn(a,i,b) do { \
-                         b[0][0] = a[i++]; \
-                         b[0][1] = a[i++]; \
-                         b[0][2] = a[i++]; \
-                         b[1][0] = a[i++]; \
-                         b[1][1] = a[i++]; \
-                         b[1][2] = a[i++]; \
+#define CopyIn(a,i,b,n) do { \
+                         if ((n) == 1) \
+                             b[0][0] = a[i]; \
+                         else \
+                             memcpy(b,&a[i],sizeof(b)); \
+                         i += (n); \
                        } while(0)
 
 #define CopyInStr(a,i,b) do { \
-                         b[0][0] = safe_strdup(a[i++],strdup("")); \
-                         b[0][1] = safe_strdup(a[i++],strdup("")); \
-                         b[0][2] = safe_strdup(a[i++],strdup("")); \
-                         b[1][0] = safe_strdup(a[i++],strdup("")); \
-                         b[1][1] = safe_strdup(a[i++],strdup("")); \
-                         b[1][2] = safe_strdup(a[i++],strdup("")); \
+                         b[0][0] = safe_strdup(a[i],strdup("")); i++; \
+                         b[0][1] = safe_strdup(a[i],strdup("")); i++; \
+                         b[0][2] = safe_strdup(a[i],strdup("")); i++; \
+                         b[1][0] = safe_strdup(a[i],strdup("")); i++; \
+                         b[1][1] = safe_strdup(a[i],strdup("")); i++; \
+                         b[1][2] = safe_strdup(a[i],strdup("")); i++; \
                        } while(0)
 
 #define BinDup(a,b,c,d) do { \
@@ -491,40 +493,56 @@ fmi3Status doInit(SimpleArrayTest component)
         }
     }
 
+    component->dirty_params = FMI_DIRTY_ALL;
     return fmi3OK;
 }
 
 fmi3Status doInitCalc(SimpleArrayTest component)
 {
+    fmi3UInt64 perf_start = perf_begin(component->perf);
+    trace_begin(component->traceInstance,"doInitCalc");
+    probe_entry(component,0,0.0);
     DEBUGBREAK();
 
-    BindoAll(component->boolean_vars[FMI_BOOLEAN_BOOLEANCALCULATEDPARAMETER_IDX],
-        FMI_BOOLEAN_XOR,component->boolean_vars[FMI_BOOLEAN_BOOLEANPARAMETER_IDX],component->boolean_vars[FMI_BOOLEAN_BOOLEANCONSTANT_IDX]);
-
-    BinopAll(component->uint64_vars[FMI_UINT64_UINT64CALCULATEDPARAMETER_IDX],
-        component->uint64_vars[FMI_UINT64_UINT64PARAMETER_IDX],*,component->uint64_vars[FMI_UINT64_UINT64CONSTANT_IDX]);
-    BinopAll(component->int64_vars[FMI_INT64_INT64CALCULATEDPARAMETER_IDX],
-        component->int64_vars[FMI_INT64_INT64PARAMETER_IDX],*,component->int64_vars[FMI_INT64_INT64CONSTANT_IDX]);
-    BinopAll(component->uint32_vars[FMI_UINT32_UINT32CALCULATEDPARAMETER_IDX],
-        component->uint32_vars[FMI_UINT32_UINT32PARAMETER_IDX],*,component->uint32_vars[FMI_UINT32_UINT32CONSTANT_IDX]);
-    BinopAll(component->int32_vars[FMI_INT32_INT32CALCULATEDPARAMETER_IDX],
-        component->int32_vars[FMI_INT32_INT32PARAMETER_IDX],*,component->int32_vars[FMI_INT32_INT32CONSTANT_IDX]);
-    BinopAll(component->uint16_vars[FMI_UINT16_UINT16CALCULATEDPARAMETER_IDX],
-        component->uint16_vars[FMI_UINT16_UINT16PARAMETER_IDX],*,component->uint16_vars[FMI_UINT16_UINT16CONSTANT_IDX]);
-    BinopAll(component->int16_vars[FMI_INT16_INT16CALCULATEDPARAMETER_IDX],
-        component->int16_vars[FMI_INT16_INT16PARAMETER_IDX],*,component->int16_vars[FMI_INT16_INT16CONSTANT_IDX]);
-    BinopAll(component->uint8_vars[FMI_UINT8_UINT8CALCULATEDPARAMETER_IDX],
-        component->uint8_vars[FMI_UINT8_UINT8PARAMETER_IDX],*,component->uint8_vars[FMI_UINT8_UINT8CONSTANT_IDX]);
-    BinopAll(component->int8_vars[FMI_INT8_INT8CALCULATEDPARAMETER_IDX],
-        component->int8_vars[FMI_INT8_INT8PARAMETER_IDX],*,component->int8_vars[FMI_INT8_INT8CONSTANT_IDX]);
-
-    BinopAll(component->float64_vars[FMI_FLOAT64_FLOAT64CALCULATEDPARAMETER_IDX],
-        component->float64_vars[FMI_FLOAT64_FLOAT64PARAMETER_IDX],*,component->float64_vars[FMI_FLOAT64_FLOAT64CONSTANT_IDX]);
-    BinopAll(component->float32_vars[FMI_FLOAT32_FLOAT32CALCULATEDPARAMETER_IDX],
-        component->float32_vars[FMI_FLOAT32_FLOAT32PARAMETER_IDX],*,component->float32_vars[FMI_FLOAT32_FLOAT32CONSTANT_IDX]);
-
-    StringConcatAll(component->string_vars[FMI_STRING_STRINGCALCULATEDPARAMETER_IDX],
-        component->string_vars[FMI_STRING_STRINGPARAMETER_IDX],component->string_vars[FMI_STRING_STRINGCONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_BOOLEAN)
+        BindoAll(component->boolean_vars[FMI_BOOLEAN_BOOLEANCALCULATEDPARAMETER_IDX],
+            FMI_BOOLEAN_XOR,component->boolean_vars[FMI_BOOLEAN_BOOLEANPARAMETER_IDX],component->boolean_vars[FMI_BOOLEAN_BOOLEANCONSTANT_IDX]);
+
+    if (component->dirty_params & FMI_DIRTY_UINT64)
+        BinopAll(component->uint64_vars[FMI_UINT64_UINT64CALCULATEDPARAMETER_IDX],
+            component->uint64_vars[FMI_UINT64_UINT64PARAMETER_IDX],*,component->uint64_vars[FMI_UINT64_UINT64CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_INT64)
+        BinopAll(component->int64_vars[FMI_INT64_INT64CALCULATEDPARAMETER_IDX],
+            component->int64_vars[FMI_INT64_INT64PARAMETER_IDX],*,component->int64_vars[FMI_INT64_INT64CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_UINT32)
+        BinopAll(component->uint32_vars[FMI_UINT32_UINT32CALCULATEDPARAMETER_IDX],
+            component->uint32_vars[FMI_UINT32_UINT32PARAMETER_IDX],*,component->uint32_vars[FMI_UINT32_UINT32CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_INT32)
+        BinopAll(component->int32_vars[FMI_INT32_INT32CALCULATEDPARAMETER_IDX],
+            component->int32_vars[FMI_INT32_INT32PARAMETER_IDX],*,component->int32_vars[FMI_INT32_INT32CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_UINT16)
+        BinopAll(component->uint16_vars[FMI_UINT16_UINT16CALCULATEDPARAMETER_IDX],
+            component->uint16_vars[FMI_UINT16_UINT16PARAMETER_IDX],*,component->uint16_vars[FMI_UINT16_UINT16CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_INT16)
+        BinopAll(component->int16_vars[FMI_INT16_INT16CALCULATEDPARAMETER_IDX],
+            component->int16_vars[FMI_INT16_INT16PARAMETER_IDX],*,component->int16_vars[FMI_INT16_INT16CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_UINT8)
+        BinopAll(component->uint8_vars[FMI_UINT8_UINT8CALCULATEDPARAMETER_IDX],
+            component->uint8_vars[FMI_UINT8_UINT8PARAMETER_IDX],*,component->uint8_vars[FMI_UINT8_UINT8CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_INT8)
+        BinopAll(component->int8_vars[FMI_INT8_INT8CALCULATEDPARAMETER_IDX],
+            component->int8_vars[FMI_INT8_INT8PARAMETER_IDX],*,component->int8_vars[FMI_INT8_INT8CONSTANT_IDX]);
+
+    if (component->dirty_params & FMI_DIRTY_FLOAT64)
+        BinopAll(component->float64_vars[FMI_FLOAT64_FLOAT64CALCULATEDPARAMETER_IDX],
+            component->float64_vars[FMI_FLOAT64_FLOAT64PARAMETER_IDX],*,component->float64_vars[FMI_FLOAT64_FLOAT64CONSTANT_IDX]);
+    if (component->dirty_params & FMI_DIRTY_FLOAT32)
+        BinopAll(component->float32_vars[FMI_FLOAT32_FLOAT32CALCULATEDPARAMETER_IDX],
+            component->float32_vars[FMI_FLOAT32_FLOAT32PARAMETER_IDX],*,component->float32_vars[FMI_FLOAT32_FLOAT32CONSTANT_IDX]);
+
+    if (component->dirty_params & FMI_DIRTY_STRING)
+        StringConcatAll(component->string_vars[FMI_STRING_STRINGCALCULATEDPARAMETER_IDX],
+            component->string_vars[FMI_STRING_STRINGPARAMETER_IDX],component->string_vars[FMI_STRING_STRINGCONSTANT_IDX]);
 #if 0
     free(component->binary_vars[FMI_BINARY_BINARYCALCULATEDPARAMETER_IDX]);
     component->binary_sizes[FMI_BINARY_BINARYCALCULATEDPARAMETER_IDX]=component->binary_sizes[FMI_BINARY_BINARYPARAMETER_IDX];
@@ -544,7 +562,8 @@ fmi3Status doInitCalc(SimpleArrayTest component)
     } else
         component->binary_vars[FMI_BINARY_BINARYCALCULATEDPARAMETER_IDX]=NULL;
 #endif
-    return fmi3OK;
+    component->dirty_params = 0;
+    return trace_return(perf_end(component->perf,PERF_DO_INIT_CALC,perf_start,fmi3OK));
 }
 
 fmi3Status doEnterInitializationMode(SimpleArrayTest component, fmi3Boolean toleranceDefined, fmi3Float64 tolerance, fmi3Float64 startTime, fmi3Boolean stopTimeDefined, fmi3Float64 stopTime)
@@ -564,9 +583,12 @@ fmi3Status doExitInitializationMode(SimpleArrayTest component)
 
 fmi3Status doCalc(SimpleArrayTest component, fmi3Float64 currentCommunicationPoint, fmi3Float64 communicationStepSize, fmi3Boolean noSetFMUStatePriorToCurrentPoint, fmi3Boolean* eventHandlingNeeded, fmi3Boolean* terminateSimulation, fmi3Boolean* earlyReturn, fmi3Float64* lastSuccessfulTime)
 {
+    trace_begin(component->traceInstance,"doCalc");
+    probe_entry(component,0,communicationStepSize);
     DEBUGBREAK();
 
-    doInitCalc(component);
+    if (component->dirty_params)
+        doInitCalc(component);
 
     BindoAll(component->boolean_vars[FMI_BOOLEAN_BOOLEANOUTPUT_IDX],
         FMI_BOOLEAN_XOR,component->boolean_vars[FMI_BOOLEAN_BOOLEANPARAMETER_IDX],component->boolean_vars[FMI_BOOLEAN_BOOLEANINPUT_IDX]);
@@ -628,7 +650,7 @@ fmi3Status doCalc(SimpleArrayTest component, fmi3Float64 currentCommunicationPoi
     *eventHandlingNeeded = fmi3False;
     *earlyReturn = fmi3False;
     *terminateSimulation = fmi3False;
-    return fmi3OK;
+    return trace_return(fmi3OK);
 }
 
 fmi3Status doTerm(SimpleArrayTest component)
@@ -653,43 +675,237 @@ void doFree(SimpleArrayTest component)
     }
 }
 
+/*
+ * FMU State Snapshots
+ *
+ * Snapshots are pooled per instance: fmi3FreeFMUState returns them to
+ * the pool and fmi3GetFMUState reuses pooled snapshots together with
+ * their string and binary buffers, so that saving and restoring state
+ * in a loop does not allocate once the pool is warm.  All snapshots
+ * are released when the instance is freed.
+ */
+
+static SimpleArrayTestState acquire_state(SimpleArrayTest component)
+{
+    SimpleArrayTestState state = component->free_states;
+    if (state != NULL) {
+        component->free_states = state->next_free;
+    } else {
+        state = calloc(1,sizeof(struct SimpleArrayTestState));
+        if (state == NULL)
+            return NULL;
+        state->next_allocated = component->allocated_states;
+        component->allocated_states = state;
+    }
+    state->next_free = NULL;
+    state->pooled = 0;
+    return state;
+}
+
+static void release_state(SimpleArrayTest component, SimpleArrayTestState state)
+{
+    state->pooled = 1;
+    state->next_free = component->free_states;
+    component->free_states = state;
+}
+
+static void free_all_states(SimpleArrayTest component)
+{
+    while (component->allocated_states != NULL) {
+        SimpleArrayTestState state = component->allocated_states;
+        size_t i;
+        component->allocated_states = state->next_allocated;
+        for (i = 0; i<FMI_STRING_VARS*2*3; i++)
+            free((&state->string_vars[0][0][0])[i]);
+        for (i = 0; i<FMI_BINARY_VARS*2*3; i++)
+            free((&state->binary_vars[0][0][0])[i]);
+        free(state);
+    }
+    component->free_states = NULL;
+}
+
+static fmi3Status save_state(SimpleArrayTest component, SimpleArrayTestState state)
+{
+    size_t i;
+    memcpy(state->boolean_vars,component->boolean_vars,sizeof(state->boolean_vars));
+    memcpy(state->uint64_vars,component->uint64_vars,sizeof(state->uint64_vars));
+    memcpy(state->int64_vars,component->int64_vars,sizeof(state->int64_vars));
+    memcpy(state->uint32_vars,component->uint32_vars,sizeof(state->uint32_vars));
+    memcpy(state->int32_vars,component->int32_vars,sizeof(state->int32_vars));
+    memcpy(state->uint16_vars,component->uint16_vars,sizeof(state->uint16_vars));
+    memcpy(state->int16_vars,component->int16_vars,sizeof(state->int16_vars));
+    memcpy(state->uint8_vars,component->uint8_vars,sizeof(state->uint8_vars));
+    memcpy(state->int8_vars,component->int8_vars,sizeof(state->int8_vars));
+    memcpy(state->float64_vars,component->float64_vars,sizeof(state->float64_vars));
+    memcpy(state->float32_vars,component->float32_vars,sizeof(state->float32_vars));
+    for (i = 0; i<FMI_STRING_VARS*2*3; i++)
+        if (!copy_string_reuse(&(&state->string_vars[0][0][0])[i],&(&state->string_capacities[0][0][0])[i],(&component->string_vars[0][0][0])[i]))
+            return fmi3Error;
+    for (i = 0; i<FMI_BINARY_VARS*2*3; i++) {
+        if (!copy_binary_reuse(&(&state->binary_vars[0][0][0])[i],&(&state->binary_capacities[0][0][0])[i],(&component->binary_vars[0][0][0])[i],(&component->binary_sizes[0][0][0])[i]))
+            return fmi3Error;
+        (&state->binary_sizes[0][0][0])[i] = (&component->binary_sizes[0][0][0])[i];
+    }
+    state->last_time = component->last_time;
+    return fmi3OK;
+}
+
+static fmi3Status restore_state(SimpleArrayTest component, SimpleArrayTestState state)
+{
+    size_t i;
+    memcpy(component->boolean_vars,state->boolean_vars,sizeof(component->boolean_vars));
+    memcpy(component->uint64_vars,state->uint64_vars,sizeof(component->uint64_vars));
+    memcpy(component->int64_vars,state->int64_vars,sizeof(component->int64_vars));
+    memcpy(component->uint32_vars,state->uint32_vars,sizeof(component->uint32_vars));
+    memcpy(component->int32_vars,state->int32_vars,sizeof(component->int32_vars));
+    memcpy(component->uint16_vars,state->uint16_vars,sizeof(component->uint16_vars));
+    memcpy(component->int16_vars,state->int16_vars,sizeof(component->int16_vars));
+    memcpy(component->uint8_vars,state->uint8_vars,sizeof(component->uint8_vars));
+    memcpy(component->int8_vars,state->int8_vars,sizeof(component->int8_vars));
+    memcpy(component->float64_vars,state->float64_vars,sizeof(component->float64_vars));
+    memcpy(component->float32_vars,state->float32_vars,sizeof(component->float32_vars));
+    for (i = 0; i<FMI_STRING_VARS*2*3; i++) {
+        /* Current buffers are reused if the saved value fits */
+        size_t capacity = ((&component->string_vars[0][0][0])[i] != NULL) ? strlen((&component->string_vars[0][0][0])[i])+1 : 0;
+        if (!copy_string_reuse(&(&component->string_vars[0][0][0])[i],&capacity,(&state->string_vars[0][0][0])[i]))
+            return fmi3Error;
+    }
+    for (i = 0; i<FMI_BINARY_VARS*2*3; i++) {
+        size_t capacity = ((&component->binary_vars[0][0][0])[i] != NULL) ? (&component->binary_sizes[0][0][0])[i] : 0;
+        if (!copy_binary_reuse(&(&component->binary_vars[0][0][0])[i],&capacity,(&state->binary_vars[0][0][0])[i],(&state->binary_sizes[0][0][0])[i]))
+            return fmi3Error;
+        (&component->binary_sizes[0][0][0])[i] = (&state->binary_sizes[0][0][0])[i];
+    }
+    component->last_time = state->last_time;
+    component->dirty_params = FMI_DIRTY_ALL;
+    return fmi3OK;
+}
+
+/*
+ * Serialized snapshots are the common state header, followed by the
+ * time, one section per typed variable array in declaration order,
+ * and length-prefixed strings and binaries.
+ */
+
+static size_t serialized_state_size(SimpleArrayTestState state)
+{
+    size_t i, size = state_header_size(FMU_TOKEN) + sizeof(state->last_time);
+    size += sizeof(state->boolean_vars);
+    size += sizeof(state->uint64_vars);
+    size += sizeof(state->int64_vars);
+    size += sizeof(state->uint32_vars);
+    size += sizeof(state->int32_vars);
+    size += sizeof(state->uint16_vars);
+    size += sizeof(state->int16_vars);
+    size += sizeof(state->uint8_vars);
+    size += sizeof(state->int8_vars);
+    size += sizeof(state->float64_vars);
+    size += sizeof(state->float32_vars);
+    for (i = 0; i<FMI_STRING_VARS*2*3; i++)
+        size += 8 + strlen((&state->string_vars[0][0][0])[i]);
+    for (i = 0; i<FMI_BINARY_VARS*2*3; i++)
+        size += 8 + (&state->binary_sizes[0][0][0])[i];
+    return size;
+}
+
+static void serialize_state(SimpleArrayTestState state, fmi3Byte* out)
+{
+    size_t i, length;
+    out = put_state_header(out,FMU_TOKEN);
+    out = put_values(out,&state->last_time,1,sizeof(state->last_time));
+    out = put_values(out,&state->boolean_vars[0][0][0],sizeof(state->boolean_vars)/sizeof(fmi3Boolean),sizeof(fmi3Boolean));
+    out = put_values(out,&state->uint64_vars[0][0][0],sizeof(state->uint64_vars)/sizeof(fmi3UInt64),sizeof(fmi3UInt64));
+    out = put_values(out,&state->int64_vars[0][0][0],sizeof(state->int64_vars)/sizeof(fmi3Int64),sizeof(fmi3Int64));
+    out = put_values(out,&state->uint32_vars[0][0][0],sizeof(state->uint32_vars)/sizeof(fmi3UInt32),sizeof(fmi3UInt32));
+    out = put_values(out,&state->int32_vars[0][0][0],sizeof(state->int32_vars)/sizeof(fmi3Int32),sizeof(fmi3Int32));
+    out = put_values(out,&state->uint16_vars[0][0][0],sizeof(state->uint16_vars)/sizeof(fmi3UInt16),sizeof(fmi3UInt16));
+    out = put_values(out,&state->int16_vars[0][0][0],sizeof(state->int16_vars)/sizeof(fmi3Int16),sizeof(fmi3Int16));
+    out = put_values(out,&state->uint8_vars[0][0][0],sizeof(state->uint8_vars)/sizeof(fmi3UInt8),sizeof(fmi3UInt8));
+    out = put_values(out,&state->int8_vars[0][0][0],sizeof(state->int8_vars)/sizeof(fmi3Int8),sizeof(fmi3Int8));
+    out = put_values(out,&state->float64_vars[0][0][0],sizeof(state->float64_vars)/sizeof(fmi3Float64),sizeof(fmi3Float64));
+    out = put_values(out,&state->float32_vars[0][0][0],sizeof(state->float32_vars)/sizeof(fmi3Float32),sizeof(fmi3Float32));
+    for (i = 0; i<FMI_STRING_VARS*2*3; i++) {
+        length = strlen((&state->string_vars[0][0][0])[i]);
+        out = put_uint64(out,length);
+        memcpy(out,(&state->string_vars[0][0][0])[i],length);
+        out += length;
+    }
+    for (i = 0; i<FMI_BINARY_VARS*2*3; i++) {
+        length = (&state->binary_sizes[0][0][0])[i];
+        out = put_uint64(out,length);
+        if (length > 0)
+            memcpy(out,(&state->binary_vars[0][0][0])[i],length);
+        out += length;
+    }
+}
+
+static int deserialize_state(SimpleArrayTestState state, const fmi3Byte* in, size_t size)
+{
+    FMUStateReader reader;
+    const fmi3Byte* bytes;
+    size_t i, length;
+    reader.pos = in;
+    reader.end = in + size;
+    reader.ok = 1;
+    get_state_header(&reader,FMU_TOKEN);
+    get_values(&reader,&state->last_time,1,sizeof(state->last_time));
+    get_booleans(&reader,&state->boolean_vars[0][0][0],sizeof(state->boolean_vars)/sizeof(fmi3Boolean));
+    get_values(&reader,&state->uint64_vars[0][0][0],sizeof(state->uint64_vars)/sizeof(fmi3UInt64),sizeof(fmi3UInt64));
+    get_values(&reader,&state->int64_vars[0][0][0],sizeof(state->int64_vars)/sizeof(fmi3Int64),sizeof(fmi3Int64));
+    get_values(&reader,&state->uint32_vars[0][0][0],sizeof(state->uint32_vars)/sizeof(fmi3UInt32),sizeof(fmi3UInt32));
+    get_values(&reader,&state->int32_vars[0][0][0],sizeof(state->int32_vars)/sizeof(fmi3Int32),sizeof(fmi3Int32));
+    get_values(&reader,&state->uint16_vars[0][0][0],sizeof(state->uint16_vars)/sizeof(fmi3UInt16),sizeof(fmi3UInt16));
+    get_values(&reader,&state->int16_vars[0][0][0],sizeof(state->int16_vars)/sizeof(fmi3Int16),sizeof(fmi3Int16));
+    get_values(&reader,&state->uint8_vars[0][0][0],sizeof(state->uint8_vars)/sizeof(fmi3UInt8),sizeof(fmi3UInt8));
+    get_values(&reader,&state->int8_vars[0][0][0],sizeof(state->int8_vars)/sizeof(fmi3Int8),sizeof(fmi3Int8));
+    get_values(&reader,&state->float64_vars[0][0][0],sizeof(state->float64_vars)/sizeof(fmi3Float64),sizeof(fmi3Float64));
+    get_values(&reader,&state->float32_vars[0][0][0],sizeof(state->float32_vars)/sizeof(fmi3Float32),sizeof(fmi3Float32));
+    for (i = 0; reader.ok && i<FMI_STRING_VARS*2*3; i++) {
+        bytes = get_bytes(&reader,&length);
+        if (!reader.ok || memchr(bytes,0,length) != NULL ||
+            !copy_chars_reuse(&(&state->string_vars[0][0][0])[i],&(&state->string_capacities[0][0][0])[i],(const char*)bytes,length))
+            return 0;
+    }
+    for (i = 0; reader.ok && i<FMI_BINARY_VARS*2*3; i++) {
+        bytes = get_bytes(&reader,&length);
+        if (!reader.ok || !copy_binary_reuse(&(&state->binary_vars[0][0][0])[i],&(&state->binary_capacities[0][0][0])[i],bytes,length))
+            return 0;
+        (&state->binary_sizes[0][0][0])[i] = length;
+    }
+    return reader.ok && reader.pos == reader.end;
+}
+
 /*
  * FMI 3.0 Co-Simulation Interface API
  */
 
 FMI3_Export const char* fmi3GetVersion()
 {
+    trace_begin(0,"fmi3GetVersion");
+    probe_entry(NULL,0,0.0);
+    trace_end();
     return fmi3Version;
 }
 
 FMI3_Export fmi3Status fmi3SetDebugLogging(fmi3Instance instance, fmi3Boolean loggingOn, size_t nCategories, const fmi3String categories[])
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3SetDebugLogging");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3SetDebugLogging(%s)", loggingOn ? "true" : "false");
     myc->loggingOn = loggingOn ? 1 : 0;
 
-    for (;myc->loggingCategories!=NULL && myc->nCategories>0;) free(myc->loggingCategories[--(myc->nCategories)]);
-    free(myc->loggingCategories);
-    myc->loggingCategories = NULL;
-    myc->nCategories = 0;
-
     if (categories && (nCategories > 0)) {
-        myc->loggingCategories = calloc(nCategories,sizeof(char*));
-        if (myc->loggingCategories != NULL) {
-            size_t i;
-            myc->nCategories = nCategories;
-            for (i=0;i<nCategories;i++) myc->loggingCategories[i]=safe_strdup(categories[i],strdup(""));
-        }
+        size_t i;
+        myc->loggingCategoryMask = 0;
+        for (i=0;i<nCategories;i++) myc->loggingCategoryMask |= log_category_mask(categories[i]);
     } else {
-        myc->loggingCategories = calloc(2,sizeof(char*));
-        if (myc->loggingCategories != NULL) {
-            myc->nCategories = 2;
-            myc->loggingCategories[0] = strdup("FMI");
-            myc->loggingCategories[1] = strdup("BINARY");
-        }
+        myc->loggingCategoryMask = LOG_CATEGORIES_ALL;
     }
 
-    return fmi3OK;
+    update_perf_counters(myc);
+
+    return trace_return(fmi3OK);
 }
 
 /*
@@ -711,6 +927,8 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
 {
     SimpleArrayTest myc = NULL;
 
+    trace_begin(0,"fmi3InstantiateCoSimulation");
+    probe_entry(NULL,0,0.0);
 #ifdef FMU_TOKEN
     if (instantiationToken!=NULL && 0!=strcmp(instantiationToken,FMU_TOKEN)) {
         fmi_verbose_log_global("fmi3InstantiateCoSimulation(\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,...) = NULL (GUID mismatch, expected %s)",
@@ -718,6 +936,7 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
             (resourcePath != NULL) ? resourcePath : "<NULL>",
             visible, loggingOn, eventModeUsed, earlyReturnAllowed,
             FMU_TOKEN);
+        trace_end();
         return NULL;
     }
 #endif
@@ -729,9 +948,12 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
             instanceName, instantiationToken,
             (resourcePath != NULL) ? resourcePath : "<NULL>",
             visible, loggingOn, eventModeUsed, earlyReturnAllowed);
+        trace_end();
         return NULL;
     }
 
+    private_log_attach();
+
     myc->instanceName=safe_strdup(instanceName,strdup(FMU_MODEL_NAME));
     myc->instantiationToken=safe_strdup(instantiationToken,strdup(FMU_TOKEN));
     myc->resourcePath=safe_strdup(resourcePath,NULL);
@@ -745,24 +967,29 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
 
     myc->last_time=0.0;
 
-    myc->loggingCategories = calloc(2,sizeof(char*));
-    if (myc->loggingCategories != NULL) {
-        myc->nCategories = 2;
-        myc->loggingCategories[0] = strdup("FMI");
-        myc->loggingCategories[1] = strdup("BINARY");
-    }
+    myc->loggingCategoryMask = LOG_CATEGORIES_ALL;
+    update_perf_counters(myc);
+    myc->traceInstance = trace_attach(myc->instanceName);
+#ifdef PRIVATE_LOG_BINARY
+    myc->binaryLog = binary_log_open(FMU_MODEL_NAME,myc->instanceName,myc);
+#endif
 
     if (doInit(myc) != fmi3OK) {
         fmi_verbose_log_global("fmi3InstantiateCoSimulation(\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,...) = NULL (doInit failure)",
             instanceName, instantiationToken,
             (resourcePath != NULL) ? resourcePath : "<NULL>",
             visible, loggingOn, eventModeUsed, earlyReturnAllowed);
+#ifdef PRIVATE_LOG_BINARY
+        binary_log_close(myc->binaryLog);
+#endif
+        free(myc->perf);
+        trace_detach(myc->traceInstance);
         free(myc->resourcePath);
         free(myc->instantiationToken);
         free(myc->instanceName);
-        for (;myc->loggingCategories!=NULL && myc->nCategories>0;) free(myc->loggingCategories[--(myc->nCategories)]);
-        free(myc->loggingCategories);
         free(myc);
+        private_log_detach();
+        trace_end();
         return NULL;
     }
     fmi_verbose_log_global("fmi3InstantiateCoSimulation(\"%s\",\"%s\",\"%s\",%d,%d,%d,%d,...) = %p",
@@ -771,6 +998,7 @@ FMI3_Export fmi3Instance fmi3InstantiateCoSimulation(
         visible, loggingOn, eventModeUsed, earlyReturnAllowed,
         myc);
 
+    trace_end();
     return (fmi3Instance)myc;
 }
 
@@ -782,15 +1010,19 @@ FMI3_Export fmi3Status fmi3EnterInitializationMode(fmi3Instance instance,
     fmi3Float64 stopTime)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3EnterInitializationMode");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3EnterInitializationMode(%d,%g,%g,%d,%g)", toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime);
-    return doEnterInitializationMode(myc,toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime);
+    return trace_return(doEnterInitializationMode(myc,toleranceDefined, tolerance, startTime, stopTimeDefined, stopTime));
 }
 
 FMI3_Export fmi3Status fmi3ExitInitializationMode(fmi3Instance instance)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3ExitInitializationMode");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3ExitInitializationMode()");
-    return doExitInitializationMode(myc);
+    return trace_return(doExitInitializationMode(myc));
 }
 
 FMI3_Export fmi3Status fmi3DoStep(fmi3Instance instance,
@@ -803,466 +1035,834 @@ FMI3_Export fmi3Status fmi3DoStep(fmi3Instance instance,
                                   fmi3Float64* lastSuccessfulTime)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    trace_begin(myc->traceInstance,"fmi3DoStep");
+    probe_entry(myc,0,communicationStepSize);
     fmi_verbose_log(myc,"fmi3DoStep(%g,%g,%d,%p,%p,%p,%p)", currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
-    return doCalc(myc,currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime);
+    return trace_return(perf_end(myc->perf,PERF_DO_STEP,perf_start,doCalc(myc,currentCommunicationPoint, communicationStepSize, noSetFMUStatePriorToCurrentPoint, eventHandlingNeeded, terminateSimulation, earlyReturn, lastSuccessfulTime)));
 }
 
 FMI3_Export fmi3Status fmi3Terminate(fmi3Instance instance)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3Terminate");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3Terminate()");
-    return doTerm(myc);
+    log_perf_counters(myc);
+    return trace_return(doTerm(myc));
 }
 
 FMI3_Export fmi3Status fmi3Reset(fmi3Instance instance)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3Reset");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3Reset()");
     doFree(myc);
-    return doInit(myc);
+    return trace_return(doInit(myc));
 }
 
 FMI3_Export void fmi3FreeInstance(fmi3Instance instance)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3FreeInstance");
+    probe_entry(myc,0,0.0);
     fmi_verbose_log(myc,"fmi3FreeInstance()");
     doFree(myc);
+    free_all_states(myc);
+    plan_free_all(&myc->plans);
 
+#ifdef PRIVATE_LOG_BINARY
+    binary_log_close(myc->binaryLog);
+#endif
+    free(myc->perf);
+    trace_end();
+    trace_detach(myc->traceInstance);
     free(myc->resourcePath);
     free(myc->instantiationToken);
     free(myc->instanceName);
-    for (;myc->loggingCategories!=NULL && myc->nCategories>0;) free(myc->loggingCategories[--(myc->nCategories)]);
-    free(myc->loggingCategories);
     free(myc);
+    private_log_detach();
 }
 
 /*
  * Data Exchange Functions
  */
 
-#define check_array_sizes() \
+/*
+ * The value references are checked and copied in one pass: each one
+ * is checked to be valid and to fit into the remaining values before
+ * its variable is copied, and nValues is checked to have been used
+ * up at the end.  A setter returning fmi3Error may thus have set the
+ * variables before the offending value reference, which is permitted
+ * and needs no rollback: their calculated parameters are marked dirty
+ * as usual and are updated by the next successful set or step.
+ */
+#define checked_vr_idx(idx,n,i,j,type) \
+    fmi3ValueReference idx; \
+    size_t n; \
     do { \
-        size_t count, iter; \
-        for (iter=0,count=0;iter<nValueReferences;iter++) \
-            count += (valueReferences[iter] == FMI_FLOAT64_BASE_VR + FMI_FLOAT64_TIME_IDX) ? 1:6; \
-        if (nValues != count) { \
-            error_log(instance,"nValues %zu is not equal to expected value %zu for array variable acccess!",nValues,count); \
-            return fmi3Error; \
+        idx = valueReferences[i] - FMI_##type##_BASE_VR; \
+        if (valueReferences[i]<FMI_##type##_BASE_VR || idx>=FMI_##type##_VARS) { \
+            error_log(instance,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type %s: Must be between %zu and %zu.",valueReferences[i],#type,FMI_##type##_BASE_VR,FMI_##type##_BASE_VR + FMI_##type##_VARS - 1); \
+            return trace_return(fmi3Error); \
+        } \
+        n = (valueReferences[i] == FMI_FLOAT64_BASE_VR + FMI_FLOAT64_TIME_IDX) ? 1 : 6; \
+        if (n > nValues - j) { \
+            error_log(instance,FMI3X_ERROR_ARGUMENT,"nValues %zu is too small for array variable acccess, value reference %zu needs values up to %zu!",nValues,valueReferences[i],j + n); \
+            return trace_return(fmi3Error); \
         } \
     } while(0)
 
-#define checked_vr_idx(idx,i,type) \
-    fmi3ValueReference idx; \
+#define check_values_used(j) \
     do { \
-        idx = valueReferences[i] - FMI_##type##_BASE_VR; \
-        if (valueReferences[i]<FMI_##type##_BASE_VR || idx>=FMI_##type##_VARS) { \
-            error_log(instance,"Invalid value reference %zu for type %s: Must be between %zu and %zu.",valueReferences[i],#type,FMI_##type##_BASE_VR,FMI_##type##_BASE_VR + FMI_##type##_VARS - 1); \
-            return fmi3Error; \
+        if (j != nValues) { \
+            error_log(instance,FMI3X_ERROR_ARGUMENT,"nValues %zu is not equal to expected value %zu for array variable acccess!",nValues,j); \
+            return trace_return(fmi3Error); \
         } \
     } while(0)
 
 FMI3_Export fmi3Status fmi3GetFloat64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Float64 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetFloat64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetFloat64(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,FLOAT64);
-        if (idx==FMI_FLOAT64_TIME_IDX)
-            values[j++]=myc->float64_vars[idx][0][0];
-        else
-            CopyOut(values,j,myc->float64_vars[idx]);
+        checked_vr_idx(idx,n,i,j,FLOAT64);
+        CopyOut(values,j,myc->float64_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_FLOAT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetFloat32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Float32 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetFloat32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetFloat32(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,FLOAT32);
-        CopyOut(values,j,myc->float32_vars[idx]);
+        checked_vr_idx(idx,n,i,j,FLOAT32);
+        CopyOut(values,j,myc->float32_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_FLOAT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt64 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt64(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT64);
-        CopyOut(values,j,myc->uint64_vars[idx]);
+        checked_vr_idx(idx,n,i,j,UINT64);
+        CopyOut(values,j,myc->uint64_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int64 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt64(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT64);
-        CopyOut(values,j,myc->int64_vars[idx]);
+        checked_vr_idx(idx,n,i,j,INT64);
+        CopyOut(values,j,myc->int64_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_INT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt32 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt32(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT32);
-        CopyOut(values,j,myc->uint32_vars[idx]);
+        checked_vr_idx(idx,n,i,j,UINT32);
+        CopyOut(values,j,myc->uint32_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int32 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt32(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT32);
-        CopyOut(values,j,myc->int32_vars[idx]);
+        checked_vr_idx(idx,n,i,j,INT32);
+        CopyOut(values,j,myc->int32_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_INT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt16 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt16(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT16);
-        CopyOut(values,j,myc->uint16_vars[idx]);
+        checked_vr_idx(idx,n,i,j,UINT16);
+        CopyOut(values,j,myc->uint16_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int16 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt16(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT16);
-        CopyOut(values,j,myc->int16_vars[idx]);
+        checked_vr_idx(idx,n,i,j,INT16);
+        CopyOut(values,j,myc->int16_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_INT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetUInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3UInt8 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetUInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetUInt8(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT8);
-        CopyOut(values,j,myc->uint8_vars[idx]);
+        checked_vr_idx(idx,n,i,j,UINT8);
+        CopyOut(values,j,myc->uint8_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_UINT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Int8 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetInt8(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT8);
-        CopyOut(values,j,myc->int8_vars[idx]);
+        checked_vr_idx(idx,n,i,j,INT8);
+        CopyOut(values,j,myc->int8_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_INT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetBoolean(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3Boolean values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetBoolean");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetBoolean(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,BOOLEAN);
-        CopyOut(values,j,myc->boolean_vars[idx]);
+        checked_vr_idx(idx,n,i,j,BOOLEAN);
+        CopyOut(values,j,myc->boolean_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_BOOLEAN,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetString(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, fmi3String values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetString");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetString(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,STRING);
-        CopyOut(values,j,myc->string_vars[idx]);
+        checked_vr_idx(idx,n,i,j,STRING);
+        CopyOut(values,j,myc->string_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_STRING,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3GetBinary(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, size_t valueSizes[], fmi3Binary values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
+    trace_begin(myc->traceInstance,"fmi3GetBinary");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3GetBinary(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
         size_t j_init = j;
-        checked_vr_idx(idx,i,BINARY);
-        CopyOut(valueSizes,j,myc->binary_sizes[idx]);
-        CopyOut(values,j_init,myc->binary_vars[idx]);
+        checked_vr_idx(idx,n,i,j,BINARY);
+        CopyOut(valueSizes,j,myc->binary_sizes[idx],n);
+        CopyOut(values,j_init,myc->binary_vars[idx],n);
     }
-    return fmi3OK;
+    check_values_used(j);
+    return trace_return(perf_end(myc->perf,PERF_GET_BINARY,perf_start,fmi3OK));
 }
 
+#define mark_dirty(idx,type) \
+    do { \
+        if (idx == FMI_##type##_##type##CONSTANT_IDX || idx == FMI_##type##_##type##PARAMETER_IDX || idx == FMI_##type##_##type##CALCULATEDPARAMETER_IDX) \
+            myc->dirty_params |= FMI_DIRTY_##type; \
+    } while(0)
+
 FMI3_Export fmi3Status fmi3SetFloat64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Float64 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetFloat64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetFloat64(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,FLOAT64);
-        CopyIn(values,j,myc->float64_vars[idx]);
-        tuned |= (idx == FMI_FLOAT64_FLOAT64PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,FLOAT64);
+        CopyIn(values,j,myc->float64_vars[idx],n);
+        mark_dirty(idx,FLOAT64);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_FLOAT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetFloat32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Float32 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetFloat32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetFloat32(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,FLOAT32);
-        CopyIn(values,j,myc->float32_vars[idx]);
-        tuned |= (idx == FMI_FLOAT32_FLOAT32PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,FLOAT32);
+        CopyIn(values,j,myc->float32_vars[idx],n);
+        mark_dirty(idx,FLOAT32);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_FLOAT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt64 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt64(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT64);
-        CopyIn(values,j,myc->uint64_vars[idx]);
-        tuned |= (idx == FMI_UINT64_UINT64PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,UINT64);
+        CopyIn(values,j,myc->uint64_vars[idx],n);
+        mark_dirty(idx,UINT64);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt64(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int64 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt64");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt64(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT64);
-        CopyIn(values,j,myc->int64_vars[idx]);
-        tuned |= (idx == FMI_INT64_INT64PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,INT64);
+        CopyIn(values,j,myc->int64_vars[idx],n);
+        mark_dirty(idx,INT64);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT64,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt32 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt32(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT32);
-        CopyIn(values,j,myc->uint32_vars[idx]);
-        tuned |= (idx == FMI_UINT32_UINT32PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,UINT32);
+        CopyIn(values,j,myc->uint32_vars[idx],n);
+        mark_dirty(idx,UINT32);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt32(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int32 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt32");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt32(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT32);
-        CopyIn(values,j,myc->int32_vars[idx]);
-        tuned |= (idx == FMI_INT32_INT32PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,INT32);
+        CopyIn(values,j,myc->int32_vars[idx],n);
+        mark_dirty(idx,INT32);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT32,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt16 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt16(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT16);
-        CopyIn(values,j,myc->uint16_vars[idx]);
-        tuned |= (idx == FMI_UINT16_UINT16PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,UINT16);
+        CopyIn(values,j,myc->uint16_vars[idx],n);
+        mark_dirty(idx,UINT16);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt16(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int16 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt16");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt16(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT16);
-        CopyIn(values,j,myc->int16_vars[idx]);
-        tuned |= (idx == FMI_INT16_INT16PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,INT16);
+        CopyIn(values,j,myc->int16_vars[idx],n);
+        mark_dirty(idx,INT16);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT16,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetUInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3UInt8 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetUInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetUInt8(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,UINT8);
-        CopyIn(values,j,myc->uint8_vars[idx]);
-        tuned |= (idx == FMI_UINT8_UINT8PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,UINT8);
+        CopyIn(values,j,myc->uint8_vars[idx],n);
+        mark_dirty(idx,UINT8);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_UINT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetInt8(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Int8 values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetInt8");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetInt8(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,INT8);
-        CopyIn(values,j,myc->int8_vars[idx]);
-        tuned |= (idx == FMI_INT8_INT8PARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,INT8);
+        CopyIn(values,j,myc->int8_vars[idx],n);
+        mark_dirty(idx,INT8);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_INT8,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetBoolean(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3Boolean values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetBoolean");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetBoolean(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,BOOLEAN);
-        CopyIn(values,j,myc->boolean_vars[idx]);
-        tuned |= (idx == FMI_BOOLEAN_BOOLEANPARAMETER_IDX);
+        checked_vr_idx(idx,n,i,j,BOOLEAN);
+        CopyIn(values,j,myc->boolean_vars[idx],n);
+        mark_dirty(idx,BOOLEAN);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_BOOLEAN,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetString(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const fmi3String values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetString");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetString(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,STRING);
+        checked_vr_idx(idx,n,i,j,STRING);
         DoAll(myc->string_vars[idx],free);
         CopyInStr(values,j,myc->string_vars[idx]);
-        tuned |= (idx == FMI_STRING_STRINGPARAMETER_IDX);
+        mark_dirty(idx,STRING);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
-    return fmi3OK;
+    return trace_return(perf_end(myc->perf,PERF_SET_STRING,perf_start,fmi3OK));
 }
 
 FMI3_Export fmi3Status fmi3SetBinary(fmi3Instance instance, const fmi3ValueReference valueReferences[], size_t nValueReferences, const size_t valueSizes[], const fmi3Binary values[], size_t nValues)
 {
     SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
     size_t i,j;
-    int tuned = 0;
+    trace_begin(myc->traceInstance,"fmi3SetBinary");
+    probe_entry(myc,nValueReferences,0.0);
     fmi_verbose_log(myc,"fmi3SetBinary(...)");
-    check_array_sizes();
     for (i = 0,j = 0; i<nValueReferences; i++) {
-        checked_vr_idx(idx,i,BINARY);
+        checked_vr_idx(idx,n,i,j,BINARY);
         DoAll(myc->binary_vars[idx],free);
         CopyInBin(valueSizes,values,j,myc->binary_sizes[idx],myc->binary_vars[idx]);
-        tuned |= (idx == FMI_BINARY_BINARYPARAMETER_IDX);
+        mark_dirty(idx,BINARY);
     }
-    if (myc->init_mode || tuned)
+    check_values_used(j);
+    if (myc->dirty_params)
         doInitCalc(myc);
+    return trace_return(perf_end(myc->perf,PERF_SET_BINARY,perf_start,fmi3OK));
+}
+
+/*
+ * FMU State
+ */
+
+FMI3_Export fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    SimpleArrayTestState state;
+    trace_begin(myc->traceInstance,"fmi3GetFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3GetFMUState(%p)",*FMUState);
+    state = (*FMUState != NULL) ? (SimpleArrayTestState)*FMUState : acquire_state(myc);
+    if (state == NULL) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory allocating FMU state.");
+        return trace_return(fmi3Error);
+    }
+    if (state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p: State has already been freed.",(void*)state);
+        return trace_return(fmi3Error);
+    }
+    if (save_state(myc,state) != fmi3OK) {
+        if (*FMUState == NULL)
+            release_state(myc,state);
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory saving FMU state.");
+        return trace_return(fmi3Error);
+    }
+    *FMUState = (fmi3FMUState)state;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    SimpleArrayTestState state = (SimpleArrayTestState)FMUState;
+    trace_begin(myc->traceInstance,"fmi3SetFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3SetFMUState(%p)",FMUState);
+    if (state == NULL || state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p.",FMUState);
+        return trace_return(fmi3Error);
+    }
+    if (restore_state(myc,state) != fmi3OK) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory restoring FMU state.");
+        return trace_return(fmi3Error);
+    }
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    SimpleArrayTestState state;
+    trace_begin(myc->traceInstance,"fmi3FreeFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3FreeFMUState(%p)",(FMUState != NULL) ? *FMUState : NULL);
+    if (FMUState == NULL || *FMUState == NULL)
+        return trace_return(fmi3OK);
+    state = (SimpleArrayTestState)*FMUState;
+    if (state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p: State has already been freed.",(void*)state);
+        return trace_return(fmi3Error);
+    }
+    release_state(myc,state);
+    *FMUState = NULL;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance, fmi3FMUState FMUState, size_t *size)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    SimpleArrayTestState state = (SimpleArrayTestState)FMUState;
+    trace_begin(myc->traceInstance,"fmi3SerializedFMUStateSize");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3SerializedFMUStateSize(%p)",FMUState);
+    if (state == NULL || state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p.",FMUState);
+        return trace_return(fmi3Error);
+    }
+    *size = serialized_state_size(state);
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3SerializeFMUState(fmi3Instance instance, fmi3FMUState FMUState, fmi3Byte serializedState[], size_t size)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    SimpleArrayTestState state = (SimpleArrayTestState)FMUState;
+    size_t needed;
+    trace_begin(myc->traceInstance,"fmi3SerializeFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3SerializeFMUState(%p,%p,%zu)",FMUState,serializedState,size);
+    if (state == NULL || state->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p.",FMUState);
+        return trace_return(fmi3Error);
+    }
+    needed = serialized_state_size(state);
+    if (size < needed) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Buffer of %zu bytes too small for serialized FMU state of %zu bytes.",size,needed);
+        return trace_return(fmi3Error);
+    }
+    serialize_state(state,serializedState);
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3DeserializeFMUState(fmi3Instance instance, const fmi3Byte serializedState[], size_t size, fmi3FMUState* FMUState)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    SimpleArrayTestState state, previous = (SimpleArrayTestState)*FMUState;
+    trace_begin(myc->traceInstance,"fmi3DeserializeFMUState");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3DeserializeFMUState(%p,%zu,%p)",serializedState,size,*FMUState);
+    if (previous != NULL && previous->pooled) {
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid FMU state %p: State has already been freed.",(void*)previous);
+        return trace_return(fmi3Error);
+    }
+    /* Into a fresh snapshot, so that a bad blob leaves the host's state intact */
+    state = acquire_state(myc);
+    if (state == NULL) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory allocating FMU state.");
+        return trace_return(fmi3Error);
+    }
+    if (!deserialize_state(state,serializedState,size)) {
+        release_state(myc,state);
+        error_log(myc,FMI3X_ERROR_FMU_STATE,"Invalid serialized FMU state of %zu bytes.",size);
+        return trace_return(fmi3Error);
+    }
+    if (previous != NULL)
+        release_state(myc,previous);
+    *FMUState = (fmi3FMUState)state;
+    return trace_return(fmi3OK);
+}
+
+/*
+ * Vendor Extensions
+ */
+
+FMI3_Export fmi3Status fmi3xGetErrorCounts(fmi3Instance instance, fmi3UInt64 counts[], size_t nCounts)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    size_t i;
+    trace_begin(myc->traceInstance,"fmi3xGetErrorCounts");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3xGetErrorCounts(...)");
+    for (i = 0; i<nCounts; i++)
+        counts[i] = (i < FMI3X_ERROR_KINDS) ? myc->errorCounts[i] : 0;
+    return trace_return(fmi3OK);
+}
+
+/*
+ * Prepared Access
+ *
+ * Value references are checked as by the accessors.  Every variable
+ * covers its six values except the time, and the variables of a type
+ * are stored back to back, so runs of value references merge into one
+ * span.  Plans for setting note which calculated parameters they make
+ * dirty, so that executing them needs no look at the individual value
+ * references.
+ */
+
+#define compile_plan_type(type,vars) \
+    case FMI3X_TYPE_##type: \
+        for (i = 0; i<nValueReferences; i++) { \
+            fmi3ValueReference idx = valueReferences[i] - FMI_##type##_BASE_VR; \
+            if (valueReferences[i]<FMI_##type##_BASE_VR || idx>=FMI_##type##_VARS) { \
+                error_log(component,FMI3X_ERROR_VALUE_REFERENCE,"Invalid value reference %zu for type %s: Must be between %zu and %zu.",(size_t)valueReferences[i],#type,(size_t)FMI_##type##_BASE_VR,(size_t)(FMI_##type##_BASE_VR + FMI_##type##_VARS - 1)); \
+                return fmi3Error; \
+            } \
+            if (plan != NULL) { \
+                if (valueReferences[i] == FMI_FLOAT64_BASE_VR + FMI_FLOAT64_TIME_IDX) \
+                    plan_add(plan,&component->vars[idx][0][0],1,sizeof(component->vars[idx][0][0])); \
+                else \
+                    plan_add(plan,&component->vars[idx][0][0],6,sizeof(component->vars[idx][0][0])); \
+                if (idx == FMI_##type##_##type##CONSTANT_IDX || idx == FMI_##type##_##type##PARAMETER_IDX || idx == FMI_##type##_##type##CALCULATEDPARAMETER_IDX) \
+                    plan->flags |= FMI_DIRTY_##type; \
+            } \
+        } \
+        break;
+
+/* Check the value references, and add their storage to plan unless NULL */
+static fmi3Status compile_plan(SimpleArrayTest component, fmi3xAccessPlan plan, int type, const fmi3ValueReference valueReferences[], size_t nValueReferences)
+{
+    size_t i;
+    switch (type) {
+        compile_plan_type(FLOAT32,float32_vars)
+        compile_plan_type(FLOAT64,float64_vars)
+        compile_plan_type(INT8,int8_vars)
+        compile_plan_type(UINT8,uint8_vars)
+        compile_plan_type(INT16,int16_vars)
+        compile_plan_type(UINT16,uint16_vars)
+        compile_plan_type(INT32,int32_vars)
+        compile_plan_type(UINT32,uint32_vars)
+        compile_plan_type(INT64,int64_vars)
+        compile_plan_type(UINT64,uint64_vars)
+        compile_plan_type(BOOLEAN,boolean_vars)
+        default:
+            error_log(component,FMI3X_ERROR_ARGUMENT,"Invalid type %d for prepared access.",type);
+            return fmi3Error;
+    }
     return fmi3OK;
 }
 
+FMI3_Export fmi3Status fmi3xPrepareAccess(fmi3Instance instance, int type, fmi3Boolean set, const fmi3ValueReference valueReferences[], size_t nValueReferences, size_t* nValues, fmi3xAccessPlan* plan)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xPrepareAccess");
+    probe_entry(myc,nValueReferences,0.0);
+    fmi_verbose_log(myc,"fmi3xPrepareAccess(%d,%d,...)",type,set);
+    *plan = NULL;
+    if (compile_plan(myc,NULL,type,valueReferences,nValueReferences) != fmi3OK)
+        return trace_return(fmi3Error);
+    *plan = plan_alloc(myc,set,nValueReferences);
+    if (*plan == NULL) {
+        error_log(myc,FMI3X_ERROR_MEMORY,"Out of memory preparing access to %zu value references.",nValueReferences);
+        return trace_return(fmi3Error);
+    }
+    compile_plan(myc,*plan,type,valueReferences,nValueReferences);
+    plan_link(&myc->plans,*plan);
+    if (nValues != NULL)
+        *nValues = (*plan)->nValues;
+    return trace_return(fmi3OK);
+}
+
+FMI3_Export fmi3Status fmi3xGetPrepared(fmi3Instance instance, fmi3xAccessPlan plan, void* values, size_t nValues)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    const char* problem;
+    trace_begin(myc->traceInstance,"fmi3xGetPrepared");
+    probe_entry(myc,nValues,0.0);
+    fmi_verbose_log(myc,"fmi3xGetPrepared(%p,...)",(void*)plan);
+    problem = plan_check(myc,plan,fmi3False,nValues);
+    if (problem != NULL) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"%s",problem);
+        return trace_return(fmi3Error);
+    }
+    plan_get(plan,values);
+    return trace_return(perf_end(myc->perf,PERF_GET_PREPARED,perf_start,fmi3OK));
+}
+
+FMI3_Export fmi3Status fmi3xSetPrepared(fmi3Instance instance, fmi3xAccessPlan plan, const void* values, size_t nValues)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    fmi3UInt64 perf_start = perf_begin(myc->perf);
+    const char* problem;
+    trace_begin(myc->traceInstance,"fmi3xSetPrepared");
+    probe_entry(myc,nValues,0.0);
+    fmi_verbose_log(myc,"fmi3xSetPrepared(%p,...)",(void*)plan);
+    problem = plan_check(myc,plan,fmi3True,nValues);
+    if (problem != NULL) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"%s",problem);
+        return trace_return(fmi3Error);
+    }
+    plan_set(plan,values);
+    myc->dirty_params |= plan->flags;
+    if (myc->dirty_params)
+        doInitCalc(myc);
+    return trace_return(perf_end(myc->perf,PERF_SET_PREPARED,perf_start,fmi3OK));
+}
+
+FMI3_Export fmi3Status fmi3xFreePrepared(fmi3Instance instance, fmi3xAccessPlan plan)
+{
+    SimpleArrayTest myc = (SimpleArrayTest)instance;
+    trace_begin(myc->traceInstance,"fmi3xFreePrepared");
+    probe_entry(myc,0,0.0);
+    fmi_verbose_log(myc,"fmi3xFreePrepared(%p)",(void*)plan);
+    if (plan != NULL && !plan_free(&myc->plans,plan)) {
+        error_log(myc,FMI3X_ERROR_ARGUMENT,"Invalid prepared access plan %p: Not prepared by this instance.",(void*)plan);
+        return trace_return(fmi3Error);
+    }
+    return trace_return(fmi3OK);
+}
+
 /*
- * Unsupported Features (FMUState, Derivatives, Status Enquiries)
+ * Unsupported Features (Derivatives, Status Enquiries)
  */
 
-#define unsupported(x) { error_log(instance,"Unsupported function %s called!",#x); return fmi3Error; }
+#define unsupported(x) { trace_begin(((SimpleArrayTest)instance)->traceInstance,#x); probe_entry(instance,0,0.0); error_log(instance,FMI3X_ERROR_UNSUPPORTED,"Unsupported function %s called!",#x); return trace_return(fmi3Error); }
 
 FMI3_Export fmi3Status fmi3EnterConfigurationMode(fmi3Instance instance) unsupported(fmi3EnterConfigurationMode)
 
@@ -1348,18 +1948,6 @@ FMI3_Export fmi3Status fmi3GetVariableDependencies(fmi3Instance instance,
                                                    fmi3DependencyKind dependencyKinds[],
                                                    size_t nDependencies) unsupported(fmi3GetVariableDependencies)
 
-FMI3_Export fmi3Status fmi3GetFMUState(fmi3Instance instance, fmi3FMUState* FMUState) unsupported(fmi3GetFMUState)
-
-FMI3_Export fmi3Status fmi3SetFMUState(fmi3Instance instance, fmi3FMUState FMUState) unsupported(fmi3SetFMUState)
-
-FMI3_Export fmi3Status fmi3FreeFMUState(fmi3Instance instance, fmi3FMUState* FMUState) unsupported(fmi3FreeFMUState)
-
-FMI3_Export fmi3Status fmi3SerializedFMUStateSize(fmi3Instance instance, fmi3FMUState FMUState, size_t *size) unsupported(fmi3SerializedFMUStateSize)
-
-FMI3_Export fmi3Status fmi3SerializeFMUState(fmi3Instance instance, fmi3FMUState FMUState, fmi3Byte serializedState[], size_t size) unsupported(fmi3SerializeFMUState)
-
-FMI3_Export fmi3Status fmi3DeserializeFMUState(fmi3Instance instance, const fmi3Byte serializedState[], size_t size, fmi3FMUState* FMUState) unsupported(fmi3DeserializeFMUState)
-
 FMI3_Export fmi3Status fmi3GetDirectionalDerivative(fmi3Instance instance,
                                                     const fmi3ValueReference unknowns[],
                                                     size_t nUnknowns,
@@ -1400,8 +1988,11 @@ FMI3_Export fmi3Instance fmi3InstantiateModelExchange(
     fmi3InstanceEnvironment    instanceEnvironment,
     fmi3LogMessageCallback     logMessage)
 {
+    trace_begin(0,"fmi3InstantiateModelExchange");
+    probe_entry(NULL,0,0.0);
     if (loggingOn && logMessage)
         logMessage(instanceEnvironment,fmi3Error,"FMI","Unsupported function fmi3InstantateModelExchange called!");
+    trace_end();
     return NULL;
 }
 
@@ -1417,8 +2008,11 @@ FMI3_Export fmi3Instance fmi3InstantiateScheduledExecution(
     fmi3LockPreemptionCallback     lockPreemption,
     fmi3UnlockPreemptionCallback   unlockPreemption)
 {
+    trace_begin(0,"fmi3InstantiateScheduledExecution");
+    probe_entry(NULL,0,0.0);
     if (loggingOn && logMessage)
         logMessage(instanceEnvironment,fmi3Error,"FMI","Unsupported function fmi3InstantateScheduledExecution called!");
+    trace_end();
     return NULL;
 }
 
@@ -23,6 +23,7 @@
 #define FMI3_FUNCTION_PREFIX FMU_MODEL_IDENTIFIER ## _
 #endif
 #include "fmi3Functions.h"
+#include "VendorExtensions.h"
 
 /*
  * Variable Definitions
@@ -169,6 +170,30 @@ typedef fmi3Char* my3String;
 #define FMI_BINARY_LAST_IDX FMI_BINARY_BINARYCALCULATEDPARAMETER_IDX
 #define FMI_BINARY_VARS (FMI_BINARY_LAST_IDX+1)
 
+/*
+ * Calculated Parameter Updates
+ *
+ * Setting a constant, parameter or calculated parameter marks the
+ * calculated parameter of its type for recomputation (doInit and
+ * restoring an FMU state mark all of them), so that doInitCalc only
+ * recomputes what changed and is skipped entirely by doCalc while
+ * nothing did.
+ */
+#define FMI_DIRTY_BOOLEAN (1u<<0)
+#define FMI_DIRTY_UINT64  (1u<<1)
+#define FMI_DIRTY_INT64   (1u<<2)
+#define FMI_DIRTY_UINT32  (1u<<3)
+#define FMI_DIRTY_INT32   (1u<<4)
+#define FMI_DIRTY_UINT16  (1u<<5)
+#define FMI_DIRTY_INT16   (1u<<6)
+#define FMI_DIRTY_UINT8   (1u<<7)
+#define FMI_DIRTY_INT8    (1u<<8)
+#define FMI_DIRTY_FLOAT64 (1u<<9)
+#define FMI_DIRTY_FLOAT32 (1u<<10)
+#define FMI_DIRTY_STRING  (1u<<11)
+#define FMI_DIRTY_BINARY  (1u<<12)
+#define FMI_DIRTY_ALL ((1u<<13)-1)
+
 /*
  * Logging Control
  *
@@ -180,6 +205,10 @@ typedef fmi3Char* my3String;
  *   the FMI logging facility where appropriate.
  * - If VERBOSE_FMI_LOGGING is defined then logging of basic
  *   FMI calls is enabled, which can get very verbose.
+ *
+ * If PRIVATE_LOG_BINARY is defined in addition to PRIVATE_LOG_PATH,
+ * instance messages are recorded unformatted into a binary log file
+ * for offline decoding instead (see BinaryLog.h).
  */
 
 /* Callbacks without const */
@@ -189,6 +218,30 @@ typedef struct {
     fmi3IntermediateUpdateCallback intermediateUpdate;
 } fmi3CallbackFunctionsVar;
 
+/* FMU State Snapshot */
+typedef struct SimpleArrayTestState {
+    struct SimpleArrayTestState* next_free;
+    struct SimpleArrayTestState* next_allocated;
+    fmi3Boolean pooled;
+    fmi3Boolean boolean_vars[FMI_BOOLEAN_VARS][2][3];
+    fmi3UInt64 uint64_vars[FMI_UINT64_VARS][2][3];
+    fmi3Int64 int64_vars[FMI_INT64_VARS][2][3];
+    fmi3UInt32 uint32_vars[FMI_UINT32_VARS][2][3];
+    fmi3Int32 int32_vars[FMI_INT32_VARS][2][3];
+    fmi3UInt16 uint16_vars[FMI_UINT16_VARS][2][3];
+    fmi3Int16 int16_vars[FMI_INT16_VARS][2][3];
+    fmi3UInt8 uint8_vars[FMI_UINT8_VARS][2][3];
+    fmi3Int8 int8_vars[FMI_INT8_VARS][2][3];
+    fmi3Float64 float64_vars[FMI_FLOAT64_VARS][2][3];
+    fmi3Float32 float32_vars[FMI_FLOAT32_VARS][2][3];
+    my3String string_vars[FMI_STRING_VARS][2][3];
+    size_t string_capacities[FMI_STRING_VARS][2][3];
+    my3Binary binary_vars[FMI_BINARY_VARS][2][3];
+    size_t binary_sizes[FMI_BINARY_VARS][2][3];
+    size_t binary_capacities[FMI_BINARY_VARS][2][3];
+    double last_time;
+} *SimpleArrayTestState;
+
 /* FMU Instance */
 typedef struct SimpleArrayTest {
     /* Members */
@@ -199,8 +252,13 @@ typedef struct SimpleArrayTest {
     fmi3Boolean loggingOn;
     fmi3Boolean eventModeUsed;
     fmi3Boolean earlyReturnAllowed;
-    size_t nCategories;
-    char** loggingCategories;
+    unsigned int loggingCategoryMask;
+    fmi3UInt64 errorCounts[FMI3X_ERROR_KINDS];
+    struct PerfCounters* perf;
+    size_t traceInstance;
+#ifdef PRIVATE_LOG_BINARY
+    struct BinaryLog* binaryLog;
+#endif
     fmi3CallbackFunctionsVar functions;
     fmi3Boolean boolean_vars[FMI_BOOLEAN_VARS][2][3];
     fmi3UInt64 uint64_vars[FMI_UINT64_VARS][2][3];
@@ -218,4 +276,8 @@ typedef struct SimpleArrayTest {
     size_t binary_sizes[FMI_BINARY_VARS][2][3];
     double last_time;
     fmi3Boolean init_mode;
+    unsigned int dirty_params;
+    SimpleArrayTestState free_states;
+    SimpleArrayTestState allocated_states;
+    fmi3xAccessPlan plans;
 } *SimpleArrayTest;
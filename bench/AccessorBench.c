@@ -0,0 +1,329 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * Accessor Microbenchmark
+ *
+ * Measures ns/call and values/s of every typed fmi3Get* and fmi3Set*
+ * function of each test FMU for batches of 1, 16 and 256 value
+ * references as well as one call covering all value references of
+ * the given type.  Batches larger than the number of variables of a
+ * type repeat the value references cyclically, which is permitted
+ * for both get and set calls.  The same batches of the numeric and
+ * boolean types are also run through plans of the fmi3xPrepareAccess
+ * vendor extension, where the FMUs provide it.
+ */
+
+typedef enum {
+    BENCH_FLOAT32, BENCH_FLOAT64,
+    BENCH_INT8, BENCH_UINT8, BENCH_INT16, BENCH_UINT16,
+    BENCH_INT32, BENCH_UINT32, BENCH_INT64, BENCH_UINT64,
+    BENCH_BOOLEAN, BENCH_STRING, BENCH_BINARY,
+    BENCH_TYPES
+} BenchType;
+
+static const char* bench_type_names[BENCH_TYPES] = {
+    "Float32", "Float64",
+    "Int8", "UInt8", "Int16", "UInt16",
+    "Int32", "UInt32", "Int64", "UInt64",
+    "Boolean", "String", "Binary"
+};
+
+/* The numeric and boolean types are in the order of FMI3X_TYPE_* */
+#define BENCH_PREPARED_TYPES (BENCH_BOOLEAN+1)
+
+typedef struct {
+    fmi3xPrepareAccessTYPE* PrepareAccess;
+    fmi3xGetPreparedTYPE* GetPrepared;
+    fmi3xSetPreparedTYPE* SetPrepared;
+    fmi3xFreePreparedTYPE* FreePrepared;
+} BenchPrepared;
+
+/* Largest single value (fmi3Float64, fmi3Int64, pointers) */
+#define BENCH_VALUE_SIZE 8
+
+#define BENCH_MAX_VRS 8
+
+typedef struct {
+    size_t nGet;
+    fmi3ValueReference get[BENCH_MAX_VRS];
+    size_t nSet;
+    fmi3ValueReference set[BENCH_MAX_VRS];
+} BenchAccessors;
+
+typedef struct {
+    const char* name;
+    BenchAccessors types[BENCH_TYPES];
+    /* Number of values behind a value reference, NULL for scalars */
+    size_t (*elements)(fmi3ValueReference vr);
+} BenchLayout;
+
+/*
+ * Variable layouts, taken from the respective modelDescription.xml:
+ * all variables of a type are read, inputs are written.
+ */
+#define SIMPLE_LAYOUT \
+    { \
+        /* Float32 */ { 5, { 51, 52, 53, 54, 55 }, 1, { 51 } }, \
+        /* Float64 */ { 6, { 45, 46, 47, 48, 49, 50 }, 1, { 46 } }, \
+        /* Int8 */    { 5, { 40, 41, 42, 43, 44 }, 1, { 40 } }, \
+        /* UInt8 */   { 5, { 35, 36, 37, 38, 39 }, 1, { 35 } }, \
+        /* Int16 */   { 5, { 30, 31, 32, 33, 34 }, 1, { 30 } }, \
+        /* UInt16 */  { 5, { 25, 26, 27, 28, 29 }, 1, { 25 } }, \
+        /* Int32 */   { 5, { 20, 21, 22, 23, 24 }, 1, { 20 } }, \
+        /* UInt32 */  { 5, { 15, 16, 17, 18, 19 }, 1, { 15 } }, \
+        /* Int64 */   { 5, { 10, 11, 12, 13, 14 }, 1, { 10 } }, \
+        /* UInt64 */  { 5, { 5, 6, 7, 8, 9 }, 1, { 5 } }, \
+        /* Boolean */ { 5, { 0, 1, 2, 3, 4 }, 1, { 0 } }, \
+        /* String */  { 5, { 56, 57, 58, 59, 60 }, 1, { 56 } }, \
+        /* Binary */  { 6, { 61, 62, 63, 64, 65, 66 }, 1, { 61 } } \
+    }
+
+static size_t simple_array_elements(fmi3ValueReference vr)
+{
+    /* All variables are 2x3 arrays, except for time */
+    return (vr == 45) ? 1 : 6;
+}
+
+static size_t dynamic_array_size = 0;
+
+static size_t dynamic_array_elements(fmi3ValueReference vr)
+{
+    return (vr >= 3 && vr <= 5) ? dynamic_array_size : 1;
+}
+
+static const BenchLayout bench_layouts[BENCH_TARGETS] = {
+    { "SimpleVariableTest", SIMPLE_LAYOUT, NULL },
+    { "SimpleArrayTest", SIMPLE_LAYOUT, simple_array_elements },
+    { "DynamicArrayTest",
+        {
+            /* Float32 */ { 0 },
+            /* Float64 */ { 4, { 0, 3, 4, 5 }, 1, { 4 } },
+            /* Int8 */    { 0 }, /* UInt8 */  { 0 },
+            /* Int16 */   { 0 }, /* UInt16 */ { 0 },
+            /* Int32 */   { 0 }, /* UInt32 */ { 0 },
+            /* Int64 */   { 0 },
+            /* UInt64 */  { 2, { 1, 2 }, 0, { 0 } },
+            /* Boolean */ { 0 }, /* String */ { 0 }, /* Binary */ { 0 }
+        },
+        dynamic_array_elements }
+};
+
+static const fmi3Byte bench_binary_value[] = { 0xCA, 0xFE, 0xBA, 0xBE };
+
+static fmi3Status bench_access(const BenchFMU* fmu, fmi3Instance instance, BenchType type, int set,
+                               const fmi3ValueReference* vrs, size_t nvrs, void* values, size_t* sizes, size_t nvalues)
+{
+#define BENCH_ACCESS_CASE(tag,name,ctype) \
+    case tag: \
+        return set ? fmu->Set##name(instance,vrs,nvrs,(const ctype*)values,nvalues) \
+                   : fmu->Get##name(instance,vrs,nvrs,(ctype*)values,nvalues);
+    switch (type) {
+        BENCH_ACCESS_CASE(BENCH_FLOAT32,Float32,fmi3Float32)
+        BENCH_ACCESS_CASE(BENCH_FLOAT64,Float64,fmi3Float64)
+        BENCH_ACCESS_CASE(BENCH_INT8,Int8,fmi3Int8)
+        BENCH_ACCESS_CASE(BENCH_UINT8,UInt8,fmi3UInt8)
+        BENCH_ACCESS_CASE(BENCH_INT16,Int16,fmi3Int16)
+        BENCH_ACCESS_CASE(BENCH_UINT16,UInt16,fmi3UInt16)
+        BENCH_ACCESS_CASE(BENCH_INT32,Int32,fmi3Int32)
+        BENCH_ACCESS_CASE(BENCH_UINT32,UInt32,fmi3UInt32)
+        BENCH_ACCESS_CASE(BENCH_INT64,Int64,fmi3Int64)
+        BENCH_ACCESS_CASE(BENCH_UINT64,UInt64,fmi3UInt64)
+        BENCH_ACCESS_CASE(BENCH_BOOLEAN,Boolean,fmi3Boolean)
+        BENCH_ACCESS_CASE(BENCH_STRING,String,fmi3String)
+        case BENCH_BINARY:
+            return set ? fmu->SetBinary(instance,vrs,nvrs,sizes,(const fmi3Binary*)values,nvalues)
+                       : fmu->GetBinary(instance,vrs,nvrs,sizes,(fmi3Binary*)values,nvalues);
+        default:
+            return fmi3Error;
+    }
+#undef BENCH_ACCESS_CASE
+}
+
+/* Fill the value buffer with valid data for set calls */
+static void bench_fill_values(BenchType type, void* values, size_t* sizes, size_t nvalues)
+{
+    size_t i;
+    for (i = 0; i<nvalues; i++) {
+        switch (type) {
+            case BENCH_FLOAT32: ((fmi3Float32*)values)[i] = 1.5f; break;
+            case BENCH_FLOAT64: ((fmi3Float64*)values)[i] = 1.5; break;
+            case BENCH_INT8: ((fmi3Int8*)values)[i] = 2; break;
+            case BENCH_UINT8: ((fmi3UInt8*)values)[i] = 2; break;
+            case BENCH_INT16: ((fmi3Int16*)values)[i] = 2; break;
+            case BENCH_UINT16: ((fmi3UInt16*)values)[i] = 2; break;
+            case BENCH_INT32: ((fmi3Int32*)values)[i] = 2; break;
+            case BENCH_UINT32: ((fmi3UInt32*)values)[i] = 2; break;
+            case BENCH_INT64: ((fmi3Int64*)values)[i] = 2; break;
+            case BENCH_UINT64: ((fmi3UInt64*)values)[i] = 2; break;
+            case BENCH_BOOLEAN: ((fmi3Boolean*)values)[i] = fmi3True; break;
+            case BENCH_STRING: ((fmi3String*)values)[i] = "bench"; break;
+            case BENCH_BINARY:
+                ((fmi3Binary*)values)[i] = bench_binary_value;
+                sizes[i] = sizeof(bench_binary_value);
+                break;
+            default: break;
+        }
+    }
+}
+
+/* Run one accessor configuration, doubling the call count until min_time is reached */
+static int bench_run(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, const BenchLayout* layout,
+                     fmi3Instance instance, BenchType type, int set, size_t batch, const char* label, const BenchPrepared* prepared)
+{
+    const BenchAccessors* accessors = &layout->types[type];
+    const fmi3ValueReference* source = set ? accessors->set : accessors->get;
+    size_t nsource = set ? accessors->nSet : accessors->nGet;
+    fmi3ValueReference* vrs;
+    void* values;
+    size_t* sizes;
+    fmi3xAccessPlan plan = NULL;
+    size_t i, nvalues = 0, calls, iterations;
+    double start, elapsed;
+    fmi3Status status;
+
+    if (nsource == 0)
+        return 1;
+
+    vrs = malloc(batch*sizeof(fmi3ValueReference));
+    for (i = 0; i<batch; i++) {
+        vrs[i] = source[i % nsource];
+        nvalues += layout->elements ? layout->elements(vrs[i]) : 1;
+    }
+    values = calloc(nvalues,BENCH_VALUE_SIZE);
+    sizes = calloc(nvalues,sizeof(size_t));
+    if (set)
+        bench_fill_values(type,values,sizes,nvalues);
+
+    if (prepared != NULL) {
+        size_t planned = 0;
+        status = prepared->PrepareAccess(instance,(int)type,set ? fmi3True : fmi3False,vrs,batch,&planned,&plan);
+        if (status == fmi3OK && planned != nvalues)
+            status = fmi3Error;
+        if (status == fmi3OK)
+            status = set ? prepared->SetPrepared(instance,plan,values,nvalues) : prepared->GetPrepared(instance,plan,values,nvalues);
+    } else {
+        status = bench_access(fmu,instance,type,set,vrs,batch,values,sizes,nvalues);
+    }
+    if (status != fmi3OK) {
+        fprintf(stderr,"%s: fmi3%s%s%s failed for batch %zu\n",fmu->name,prepared?"x":"",set?"Set":"Get",prepared?"Prepared":bench_type_names[type],batch);
+        if (plan != NULL)
+            prepared->FreePrepared(instance,plan);
+        free(vrs); free(values); free(sizes);
+        return 0;
+    }
+
+    for (iterations = 16;;iterations *= 2) {
+        start = bench_now_ns();
+        if (prepared == NULL) {
+            for (calls = 0; calls<iterations; calls++)
+                bench_access(fmu,instance,type,set,vrs,batch,values,sizes,nvalues);
+        } else if (set) {
+            for (calls = 0; calls<iterations; calls++)
+                prepared->SetPrepared(instance,plan,values,nvalues);
+        } else {
+            for (calls = 0; calls<iterations; calls++)
+                prepared->GetPrepared(instance,plan,values,nvalues);
+        }
+        elapsed = bench_now_ns() - start;
+        if (elapsed >= options->min_time * 1e9)
+            break;
+    }
+
+    bench_json_record(json,fmu->name);
+    if (prepared != NULL)
+        bench_json_field(json,"function","\"fmi3x%sPrepared\"",set?"Set":"Get");
+    else
+        bench_json_field(json,"function","\"fmi3%s%s\"",set?"Set":"Get",bench_type_names[type]);
+    bench_json_field(json,"type","\"%s\"",bench_type_names[type]);
+    bench_json_field(json,"batch","\"%s\"",label);
+    bench_json_field(json,"valueReferences","%zu",batch);
+    bench_json_field(json,"valuesPerCall","%zu",nvalues);
+    bench_json_field(json,"calls","%zu",iterations);
+    bench_json_field(json,"nsPerCall","%.2f",elapsed/(double)iterations);
+    bench_json_field(json,"valuesPerSecond","%.0f",(double)nvalues*(double)iterations*1e9/elapsed);
+    bench_json_end_record(json);
+
+    if (plan != NULL)
+        prepared->FreePrepared(instance,plan);
+    free(vrs);
+    free(values);
+    free(sizes);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    static const size_t batches[] = { 1, 16, 256 };
+    BenchOptions options = { NULL, 0.05, 0, 0, 0 };
+    BenchJSON json;
+    size_t t, b;
+    int ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"accessors"))
+        return 2;
+
+    for (t = 0; t<BENCH_TARGETS; t++) {
+        const BenchLayout* layout = &bench_layouts[t];
+        BenchFMU fmu;
+        BenchPrepared prepared;
+        fmi3Instance instance;
+        int type, set;
+
+        if (!bench_load_fmu(&fmu,&bench_targets[t])) {
+            ok = 0;
+            continue;
+        }
+        instance = bench_instantiate(&fmu,fmi3False);
+        if (instance == NULL) {
+            bench_unload_fmu(&fmu);
+            ok = 0;
+            continue;
+        }
+        if (layout->elements == dynamic_array_elements) {
+            const fmi3ValueReference size_vrs[2] = { 1, 2 };
+            fmi3UInt64 sizes[2];
+            fmu.GetUInt64(instance,size_vrs,2,sizes,2);
+            dynamic_array_size = (size_t)(sizes[0]*sizes[1]);
+        }
+        prepared.PrepareAccess = (fmi3xPrepareAccessTYPE*)bench_library_symbol(fmu.library,"fmi3xPrepareAccess");
+        prepared.GetPrepared = (fmi3xGetPreparedTYPE*)bench_library_symbol(fmu.library,"fmi3xGetPrepared");
+        prepared.SetPrepared = (fmi3xSetPreparedTYPE*)bench_library_symbol(fmu.library,"fmi3xSetPrepared");
+        prepared.FreePrepared = (fmi3xFreePreparedTYPE*)bench_library_symbol(fmu.library,"fmi3xFreePrepared");
+        fprintf(stderr,"%s: running accessor benchmarks\n",fmu.name);
+
+        for (type = 0; type<BENCH_TYPES; type++) {
+            for (set = 0; set<=1; set++) {
+                char label[16];
+                size_t all = set ? layout->types[type].nSet : layout->types[type].nGet;
+                const BenchPrepared* plan = (type < BENCH_PREPARED_TYPES && prepared.PrepareAccess && prepared.GetPrepared &&
+                                             prepared.SetPrepared && prepared.FreePrepared) ? &prepared : NULL;
+                for (b = 0; b<sizeof(batches)/sizeof(batches[0]); b++) {
+                    snprintf(label,sizeof(label),"%zu",batches[b]);
+                    ok &= bench_run(&json,&options,&fmu,layout,instance,(BenchType)type,set,batches[b],label,NULL);
+                    if (plan != NULL)
+                        ok &= bench_run(&json,&options,&fmu,layout,instance,(BenchType)type,set,batches[b],label,plan);
+                }
+                ok &= bench_run(&json,&options,&fmu,layout,instance,(BenchType)type,set,all,"all",NULL);
+                if (plan != NULL)
+                    ok &= bench_run(&json,&options,&fmu,layout,instance,(BenchType)type,set,all,"all",plan);
+            }
+        }
+
+        fmu.Terminate(instance);
+        fmu.FreeInstance(instance);
+        bench_unload_fmu(&fmu);
+    }
+
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * Array Exchange Benchmark
+ *
+ * Runs DynamicArrayTest at XSize*YSize elements (default 1000x1000)
+ * through rounds of setting the whole input array, taking a step and
+ * getting the whole output array, as hosts of grid models do, with the
+ * output exchanged in each of the ways the FMU offers: copied out by
+ * fmi3GetFloat64, borrowed with fmi3xBorrowFloat64Output, or
+ * calculated directly into a host buffer bound with
+ * fmi3xBindFloat64Output.  The last round is repeated with the input
+ * read directly from a host buffer bound with fmi3xBindFloat64Input
+ * instead of being set.  Reports the time per round and per call for
+ * each way.
+ */
+
+#define BENCH_DEFAULT_X_SIZE 1000
+#define BENCH_DEFAULT_Y_SIZE 1000
+#define BENCH_STEP_SIZE 0.001
+
+enum { BENCH_COPY, BENCH_BORROW, BENCH_BIND };
+
+static const char* const bench_modes[] = { "copy", "borrow", "bind" };
+
+/* Input and output modes of the rounds */
+static const int bench_rounds[][2] = {
+    { BENCH_COPY, BENCH_COPY },
+    { BENCH_COPY, BENCH_BORROW },
+    { BENCH_COPY, BENCH_BIND },
+    { BENCH_BIND, BENCH_BIND }
+};
+
+static const fmi3ValueReference bench_input = 4;
+static const fmi3ValueReference bench_output = 5;
+
+typedef struct {
+    fmi3xBorrowFloat64OutputTYPE* BorrowFloat64Output;
+    fmi3xBindFloat64OutputTYPE* BindFloat64Output;
+    fmi3xBindFloat64InputTYPE* BindFloat64Input;
+} BenchShared;
+
+static int bench_exchange(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, const BenchShared* shared, fmi3Instance instance,
+    int input_mode, int output_mode, const fmi3Float64* input, fmi3Float64* output, size_t size)
+{
+    fmi3Boolean eventHandlingNeeded, terminateSimulation, earlyReturn;
+    fmi3Float64 lastSuccessfulTime;
+    const fmi3Float64* borrowed;
+    fmi3UInt64 generation;
+    size_t rounds, i, n;
+    double time = 0.0, set, step, get, total, check = 0.0;
+
+    if (input_mode == BENCH_BIND && shared->BindFloat64Input(instance,bench_input,input,size) != fmi3OK) {
+        fprintf(stderr,"%s: binding the input failed\n",fmu->name);
+        return 0;
+    }
+    if (output_mode == BENCH_BIND && shared->BindFloat64Output(instance,bench_output,output,size) != fmi3OK) {
+        fprintf(stderr,"%s: binding the output failed\n",fmu->name);
+        return 0;
+    }
+
+    for (rounds = 1;;rounds *= 2) {
+        set = step = get = 0.0;
+        for (i = 0; i<rounds; i++, time += BENCH_STEP_SIZE) {
+            double t0 = bench_now_ns(), t1, t2;
+            if (input_mode == BENCH_COPY)
+                fmu->SetFloat64(instance,&bench_input,1,input,size);
+            t1 = bench_now_ns();
+            fmu->DoStep(instance,time,BENCH_STEP_SIZE,fmi3True,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&lastSuccessfulTime);
+            t2 = bench_now_ns();
+            if (output_mode == BENCH_COPY) {
+                fmu->GetFloat64(instance,&bench_output,1,output,size);
+                check += output[size-1];
+            } else if (output_mode == BENCH_BORROW) {
+                shared->BorrowFloat64Output(instance,bench_output,&borrowed,&n,&generation);
+                check += borrowed[n-1];
+            } else {
+                check += output[size-1];
+            }
+            set += t1 - t0;
+            step += t2 - t1;
+            get += bench_now_ns() - t2;
+        }
+        if (set + step + get >= options->min_time * 1e9)
+            break;
+    }
+    total = set + step + get;
+
+    if (input_mode == BENCH_BIND)
+        shared->BindFloat64Input(instance,bench_input,NULL,0);
+    if (output_mode == BENCH_BIND)
+        shared->BindFloat64Output(instance,bench_output,NULL,0);
+    if (check != check) {
+        fprintf(stderr,"%s: output is not a number\n",fmu->name);
+        return 0;
+    }
+
+    bench_json_record(json,fmu->name);
+    bench_json_field(json,"input","\"%s\"",bench_modes[input_mode]);
+    bench_json_field(json,"output","\"%s\"",bench_modes[output_mode]);
+    bench_json_field(json,"elements","%zu",size);
+    bench_json_field(json,"rounds","%zu",rounds);
+    bench_json_field(json,"nsPerRound","%.1f",total/(double)rounds);
+    bench_json_field(json,"nsPerInput","%.1f",set/(double)rounds);
+    bench_json_field(json,"nsPerDoStep","%.1f",step/(double)rounds);
+    bench_json_field(json,"nsPerOutput","%.1f",get/(double)rounds);
+    bench_json_end_record(json);
+
+    fprintf(stderr,"%s: %zu elements, input %s, output %s: %.0f ns/round (input %.0f, step %.0f, output %.0f ns)\n",
+        fmu->name,size,bench_modes[input_mode],bench_modes[output_mode],total/(double)rounds,set/(double)rounds,step/(double)rounds,get/(double)rounds);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = { NULL, 0.5, 0, BENCH_DEFAULT_X_SIZE, BENCH_DEFAULT_Y_SIZE };
+    BenchJSON json;
+    BenchFMU fmu;
+    BenchShared shared;
+    fmi3Instance instance;
+    fmi3Float64 *input, *output;
+    size_t size, i;
+    int ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"arrayExchange"))
+        return 2;
+
+    size = (size_t)(options.x_size*options.y_size);
+    input = malloc(size*sizeof(fmi3Float64));
+    output = malloc(size*sizeof(fmi3Float64));
+    if (size == 0 || input == NULL || output == NULL) {
+        fprintf(stderr,"cannot allocate arrays of %zu elements\n",size);
+        free(input);
+        free(output);
+        bench_json_close(&json);
+        return 1;
+    }
+    for (i = 0; i<size; i++)
+        input[i] = (fmi3Float64)(i%1000)*0.001;
+
+    /* Only DynamicArrayTest shares its arrays */
+    if (!bench_load_fmu(&fmu,&bench_targets[2])) {
+        ok = 0;
+    } else {
+        shared.BorrowFloat64Output = (fmi3xBorrowFloat64OutputTYPE*)bench_library_symbol(fmu.library,"fmi3xBorrowFloat64Output");
+        shared.BindFloat64Output = (fmi3xBindFloat64OutputTYPE*)bench_library_symbol(fmu.library,"fmi3xBindFloat64Output");
+        shared.BindFloat64Input = (fmi3xBindFloat64InputTYPE*)bench_library_symbol(fmu.library,"fmi3xBindFloat64Input");
+        instance = bench_instantiate(&fmu,fmi3False);
+        if (shared.BorrowFloat64Output == NULL || shared.BindFloat64Output == NULL || shared.BindFloat64Input == NULL) {
+            fprintf(stderr,"%s: missing shared array extensions\n",fmu.name);
+            ok = 0;
+        } else if (instance == NULL) {
+            ok = 0;
+        } else if (!bench_configure_dynamic_array(&fmu,instance,&options)) {
+            fprintf(stderr,"%s: reconfiguration failed\n",fmu.name);
+            ok = 0;
+        } else {
+            for (i = 0; ok && i<sizeof(bench_rounds)/sizeof(bench_rounds[0]); i++)
+                ok = bench_exchange(&json,&options,&fmu,&shared,instance,bench_rounds[i][0],bench_rounds[i][1],input,output,size);
+        }
+        if (instance != NULL) {
+            fmu.Terminate(instance);
+            fmu.FreeInstance(instance);
+        }
+        bench_unload_fmu(&fmu);
+    }
+
+    free(input);
+    free(output);
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#ifdef _MSC_VER
+#define _CRT_NONSTDC_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "fmi3FunctionTypes.h"
+#include "VendorExtensions.h"
+
+#ifdef _MSC_VER
+#define BENCH_INLINE __inline
+#else
+#define BENCH_INLINE inline
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+typedef HMODULE bench_library;
+#define bench_open_library(path) LoadLibraryA(path)
+#define bench_library_symbol(lib,name) ((void*)GetProcAddress(lib,name))
+#define bench_close_library(lib) FreeLibrary(lib)
+#else
+#include <dlfcn.h>
+#include <time.h>
+typedef void* bench_library;
+#define bench_open_library(path) dlopen(path,RTLD_NOW|RTLD_LOCAL)
+#define bench_library_symbol(lib,name) dlsym(lib,name)
+#define bench_close_library(lib) dlclose(lib)
+#endif
+
+/*
+ * Host-side Benchmark Support
+ *
+ * The benchmark drivers load the built FMU shared objects directly
+ * (bypassing the FMU archive), resolve the FMI 3.0 entry points they
+ * need and drive instances through the normal co-simulation life
+ * cycle.  The shared object paths are passed in by the build system.
+ */
+
+typedef struct {
+    const char* name;
+    const char* path;
+} BenchTarget;
+
+static const BenchTarget bench_targets[] = {
+    { "SimpleVariableTest", SIMPLE_VARIABLE_TEST_LIBRARY },
+    { "SimpleArrayTest", SIMPLE_ARRAY_TEST_LIBRARY },
+    { "DynamicArrayTest", DYNAMIC_ARRAY_TEST_LIBRARY }
+};
+
+#define BENCH_TARGETS (sizeof(bench_targets)/sizeof(bench_targets[0]))
+
+/* Loaded FMU Entry Points */
+typedef struct {
+    const char* name;
+    bench_library library;
+    fmi3InstantiateCoSimulationTYPE* InstantiateCoSimulation;
+    fmi3FreeInstanceTYPE* FreeInstance;
+    fmi3SetDebugLoggingTYPE* SetDebugLogging;
+    fmi3EnterInitializationModeTYPE* EnterInitializationMode;
+    fmi3ExitInitializationModeTYPE* ExitInitializationMode;
+    fmi3EnterConfigurationModeTYPE* EnterConfigurationMode;
+    fmi3ExitConfigurationModeTYPE* ExitConfigurationMode;
+    fmi3TerminateTYPE* Terminate;
+    fmi3DoStepTYPE* DoStep;
+    fmi3GetFMUStateTYPE* GetFMUState;
+    fmi3SetFMUStateTYPE* SetFMUState;
+    fmi3FreeFMUStateTYPE* FreeFMUState;
+    fmi3SerializedFMUStateSizeTYPE* SerializedFMUStateSize;
+    fmi3SerializeFMUStateTYPE* SerializeFMUState;
+    fmi3DeserializeFMUStateTYPE* DeserializeFMUState;
+    fmi3GetFloat32TYPE* GetFloat32;
+    fmi3GetFloat64TYPE* GetFloat64;
+    fmi3GetInt8TYPE* GetInt8;
+    fmi3GetUInt8TYPE* GetUInt8;
+    fmi3GetInt16TYPE* GetInt16;
+    fmi3GetUInt16TYPE* GetUInt16;
+    fmi3GetInt32TYPE* GetInt32;
+    fmi3GetUInt32TYPE* GetUInt32;
+    fmi3GetInt64TYPE* GetInt64;
+    fmi3GetUInt64TYPE* GetUInt64;
+    fmi3GetBooleanTYPE* GetBoolean;
+    fmi3GetStringTYPE* GetString;
+    fmi3GetBinaryTYPE* GetBinary;
+    fmi3SetFloat32TYPE* SetFloat32;
+    fmi3SetFloat64TYPE* SetFloat64;
+    fmi3SetInt8TYPE* SetInt8;
+    fmi3SetUInt8TYPE* SetUInt8;
+    fmi3SetInt16TYPE* SetInt16;
+    fmi3SetUInt16TYPE* SetUInt16;
+    fmi3SetInt32TYPE* SetInt32;
+    fmi3SetUInt32TYPE* SetUInt32;
+    fmi3SetInt64TYPE* SetInt64;
+    fmi3SetUInt64TYPE* SetUInt64;
+    fmi3SetBooleanTYPE* SetBoolean;
+    fmi3SetStringTYPE* SetString;
+    fmi3SetBinaryTYPE* SetBinary;
+} BenchFMU;
+
+#define bench_resolve(fmu,fn) \
+    do { \
+        (fmu)->fn = (fmi3##fn##TYPE*)bench_library_symbol((fmu)->library,"fmi3" #fn); \
+        if ((fmu)->fn == NULL) { \
+            fprintf(stderr,"%s: missing symbol fmi3%s\n",(fmu)->name,#fn); \
+            bench_close_library((fmu)->library); \
+            return 0; \
+        } \
+    } while(0)
+
+static int bench_load_fmu(BenchFMU* fmu, const BenchTarget* target)
+{
+    memset(fmu,0,sizeof(BenchFMU));
+    fmu->name = target->name;
+    fmu->library = bench_open_library(target->path);
+    if (fmu->library == NULL) {
+        fprintf(stderr,"%s: cannot load %s\n",target->name,target->path);
+        return 0;
+    }
+    bench_resolve(fmu,InstantiateCoSimulation);
+    bench_resolve(fmu,FreeInstance);
+    bench_resolve(fmu,SetDebugLogging);
+    bench_resolve(fmu,EnterInitializationMode);
+    bench_resolve(fmu,ExitInitializationMode);
+    bench_resolve(fmu,EnterConfigurationMode);
+    bench_resolve(fmu,ExitConfigurationMode);
+    bench_resolve(fmu,Terminate);
+    bench_resolve(fmu,DoStep);
+    bench_resolve(fmu,GetFMUState);
+    bench_resolve(fmu,SetFMUState);
+    bench_resolve(fmu,FreeFMUState);
+    bench_resolve(fmu,SerializedFMUStateSize);
+    bench_resolve(fmu,SerializeFMUState);
+    bench_resolve(fmu,DeserializeFMUState);
+    bench_resolve(fmu,GetFloat32);
+    bench_resolve(fmu,GetFloat64);
+    bench_resolve(fmu,GetInt8);
+    bench_resolve(fmu,GetUInt8);
+    bench_resolve(fmu,GetInt16);
+    bench_resolve(fmu,GetUInt16);
+    bench_resolve(fmu,GetInt32);
+    bench_resolve(fmu,GetUInt32);
+    bench_resolve(fmu,GetInt64);
+    bench_resolve(fmu,GetUInt64);
+    bench_resolve(fmu,GetBoolean);
+    bench_resolve(fmu,GetString);
+    bench_resolve(fmu,GetBinary);
+    bench_resolve(fmu,SetFloat32);
+    bench_resolve(fmu,SetFloat64);
+    bench_resolve(fmu,SetInt8);
+    bench_resolve(fmu,SetUInt8);
+    bench_resolve(fmu,SetInt16);
+    bench_resolve(fmu,SetUInt16);
+    bench_resolve(fmu,SetInt32);
+    bench_resolve(fmu,SetUInt32);
+    bench_resolve(fmu,SetInt64);
+    bench_resolve(fmu,SetUInt64);
+    bench_resolve(fmu,SetBoolean);
+    bench_resolve(fmu,SetString);
+    bench_resolve(fmu,SetBinary);
+    return 1;
+}
+
+static void bench_unload_fmu(BenchFMU* fmu)
+{
+    if (fmu->library != NULL)
+        bench_close_library(fmu->library);
+    fmu->library = NULL;
+}
+
+static void bench_log_message(fmi3InstanceEnvironment instanceEnvironment, fmi3Status status, fmi3String category, fmi3String message)
+{
+    if (status >= fmi3Error)
+        fprintf(stderr,"%s: [%s] %s\n",(const char*)instanceEnvironment,category,message);
+}
+
+/* Instantiate and move through initialization mode into step mode */
+static fmi3Instance bench_instantiate(const BenchFMU* fmu, fmi3Boolean loggingOn)
+{
+    fmi3Instance instance = fmu->InstantiateCoSimulation(fmu->name,NULL,NULL,fmi3False,loggingOn,fmi3False,fmi3False,NULL,0,(fmi3InstanceEnvironment)fmu->name,bench_log_message,NULL);
+    if (instance == NULL) {
+        fprintf(stderr,"%s: instantiation failed\n",fmu->name);
+        return NULL;
+    }
+    if (fmu->EnterInitializationMode(instance,fmi3False,0.0,0.0,fmi3False,0.0) != fmi3OK ||
+        fmu->ExitInitializationMode(instance) != fmi3OK) {
+        fprintf(stderr,"%s: initialization failed\n",fmu->name);
+        fmu->FreeInstance(instance);
+        return NULL;
+    }
+    return instance;
+}
+
+/* Monotonic Clock */
+static double bench_now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+#endif
+}
+
+/* Latency Statistics over a sorted sample */
+static BENCH_INLINE int bench_compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static BENCH_INLINE double bench_percentile(const double* sorted, size_t count, double p)
+{
+    size_t index = (size_t)(p * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+/*
+ * JSON Output
+ *
+ * Results are written as one JSON document per run: a header object
+ * with the benchmark name and a "results" array of flat records, so
+ * that runs from different releases can be diffed or loaded directly.
+ */
+
+typedef struct {
+    FILE* file;
+    int records;
+} BenchJSON;
+
+static int bench_json_open(BenchJSON* json, const char* path, const char* benchmark)
+{
+    json->records = 0;
+    json->file = (path != NULL) ? fopen(path,"w") : stdout;
+    if (json->file == NULL) {
+        fprintf(stderr,"cannot open %s for writing\n",path);
+        return 0;
+    }
+    fprintf(json->file,"{\n  \"benchmark\": \"%s\",\n  \"fmiVersion\": \"3.0\",\n  \"results\": [",benchmark);
+    return 1;
+}
+
+/* Start a result record; fields are appended with bench_json_field */
+static void bench_json_record(BenchJSON* json, const char* fmu)
+{
+    fprintf(json->file,"%s\n    { \"fmu\": \"%s\"",json->records++ ? "," : "",fmu);
+}
+
+static void bench_json_field(BenchJSON* json, const char* name, const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    fprintf(json->file,", \"%s\": ",name);
+    vfprintf(json->file,format,ap);
+    va_end(ap);
+}
+
+static void bench_json_end_record(BenchJSON* json)
+{
+    fputs(" }",json->file);
+}
+
+static void bench_json_close(BenchJSON* json)
+{
+    fputs("\n  ]\n}\n",json->file);
+    if (json->file != stdout)
+        fclose(json->file);
+}
+
+/* Common command line: [-o output.json] [-t seconds] [-n count] [-x xsize] [-y ysize] */
+typedef struct {
+    const char* output;
+    double min_time;
+    size_t count;
+    fmi3UInt64 x_size;
+    fmi3UInt64 y_size;
+} BenchOptions;
+
+static int bench_parse_options(BenchOptions* options, int argc, char* argv[])
+{
+    int i;
+    for (i = 1; i<argc; i++) {
+        if (0==strcmp(argv[i],"-o") && i+1<argc)
+            options->output = argv[++i];
+        else if (0==strcmp(argv[i],"-t") && i+1<argc)
+            options->min_time = atof(argv[++i]);
+        else if (0==strcmp(argv[i],"-n") && i+1<argc)
+            options->count = (size_t)strtoull(argv[++i],NULL,10);
+        else if (0==strcmp(argv[i],"-x") && i+1<argc)
+            options->x_size = strtoull(argv[++i],NULL,10);
+        else if (0==strcmp(argv[i],"-y") && i+1<argc)
+            options->y_size = strtoull(argv[++i],NULL,10);
+        else {
+            fprintf(stderr,"Usage: %s [-o output.json] [-t seconds] [-n count] [-x xsize] [-y ysize]\n",argv[0]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Optional resizing of DynamicArrayTest via -x/-y */
+static BENCH_INLINE int bench_configure_dynamic_array(const BenchFMU* fmu, fmi3Instance instance, const BenchOptions* options)
+{
+    const fmi3ValueReference vrs[2] = { 1, 2 };
+    fmi3UInt64 sizes[2];
+    if (options->x_size == 0 && options->y_size == 0)
+        return 1;
+    if (fmu->GetUInt64(instance,vrs,2,sizes,2) != fmi3OK)
+        return 0;
+    if (options->x_size) sizes[0] = options->x_size;
+    if (options->y_size) sizes[1] = options->y_size;
+    return fmu->EnterConfigurationMode(instance) == fmi3OK &&
+           fmu->SetUInt64(instance,vrs,2,sizes,2) == fmi3OK &&
+           fmu->ExitConfigurationMode(instance) == fmi3OK;
+}
+
+#endif /* BENCH_UTIL_H */
@@ -0,0 +1,123 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * Binary Payload Benchmark
+ *
+ * Pushes binary payloads of 16 B up to 64 MB (in steps of 4x) through
+ * SimpleVariableTest, as hosts do with e.g. sensor frames: each round
+ * sets BinaryInput, takes a step, which copies it to BinaryOutput and
+ * XORs it with BinaryParameter into XorOutput, and gets both outputs.
+ * Reports the time per round and per call as well as the payload
+ * throughput for every size.
+ */
+
+#define BENCH_MIN_PAYLOAD 16
+#define BENCH_MAX_PAYLOAD (64*1024*1024)
+#define BENCH_STEP_SIZE 0.001
+
+static const fmi3ValueReference bench_binary_input = 61;
+static const fmi3ValueReference bench_binary_outputs[2] = { 62, 63 };
+
+static int bench_payload(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, fmi3Instance instance, const fmi3Byte* payload, size_t size)
+{
+    fmi3Boolean eventHandlingNeeded, terminateSimulation, earlyReturn;
+    fmi3Float64 lastSuccessfulTime;
+    fmi3Binary values[2];
+    size_t sizes[2], rounds, i;
+    double time = 0.0, set = 0.0, step = 0.0, get = 0.0, total;
+
+    /* One untimed round, so that the buffers have grown to size */
+    if (fmu->SetBinary(instance,&bench_binary_input,1,&size,&payload,1) != fmi3OK ||
+        fmu->DoStep(instance,time,BENCH_STEP_SIZE,fmi3True,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&lastSuccessfulTime) != fmi3OK ||
+        fmu->GetBinary(instance,bench_binary_outputs,2,sizes,values,2) != fmi3OK || sizes[0] != size || sizes[1] != size) {
+        fprintf(stderr,"%s: binary round trip failed for %zu bytes\n",fmu->name,size);
+        return 0;
+    }
+    time += BENCH_STEP_SIZE;
+
+    for (rounds = 1;;rounds *= 2) {
+        set = step = get = 0.0;
+        for (i = 0; i<rounds; i++, time += BENCH_STEP_SIZE) {
+            double t0 = bench_now_ns(), t1, t2;
+            fmu->SetBinary(instance,&bench_binary_input,1,&size,&payload,1);
+            t1 = bench_now_ns();
+            fmu->DoStep(instance,time,BENCH_STEP_SIZE,fmi3True,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&lastSuccessfulTime);
+            t2 = bench_now_ns();
+            fmu->GetBinary(instance,bench_binary_outputs,2,sizes,values,2);
+            set += t1 - t0;
+            step += t2 - t1;
+            get += bench_now_ns() - t2;
+        }
+        if (set + step + get >= options->min_time * 1e9)
+            break;
+    }
+    total = set + step + get;
+
+    bench_json_record(json,fmu->name);
+    bench_json_field(json,"payloadBytes","%zu",size);
+    bench_json_field(json,"rounds","%zu",rounds);
+    bench_json_field(json,"nsPerRound","%.1f",total/(double)rounds);
+    bench_json_field(json,"nsPerSetBinary","%.1f",set/(double)rounds);
+    bench_json_field(json,"nsPerDoStep","%.1f",step/(double)rounds);
+    bench_json_field(json,"nsPerGetBinary","%.1f",get/(double)rounds);
+    bench_json_field(json,"megabytesPerSecond","%.1f",(double)size*(double)rounds*1e3/total);
+    bench_json_end_record(json);
+
+    fprintf(stderr,"%s: %zu bytes: %.0f ns/round (set %.0f, step %.0f, get %.0f ns), %.1f MB/s\n",
+        fmu->name,size,total/(double)rounds,set/(double)rounds,step/(double)rounds,get/(double)rounds,
+        (double)size*(double)rounds*1e3/total);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = { NULL, 0.05, 0, 0, 0 };
+    BenchJSON json;
+    BenchFMU fmu;
+    fmi3Instance instance;
+    fmi3Byte* payload;
+    size_t size;
+    int ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"binary"))
+        return 2;
+
+    payload = malloc(BENCH_MAX_PAYLOAD);
+    if (payload == NULL) {
+        fprintf(stderr,"cannot allocate %d byte payload\n",BENCH_MAX_PAYLOAD);
+        bench_json_close(&json);
+        return 1;
+    }
+    for (size = 0; size<BENCH_MAX_PAYLOAD; size++)
+        payload[size] = (fmi3Byte)(size*31 + (size>>8));
+
+    /* Only SimpleVariableTest has scalar binary inputs and outputs */
+    if (!bench_load_fmu(&fmu,&bench_targets[0])) {
+        ok = 0;
+    } else {
+        instance = bench_instantiate(&fmu,fmi3False);
+        if (instance == NULL) {
+            ok = 0;
+        } else {
+            for (size = BENCH_MIN_PAYLOAD; ok && size<=BENCH_MAX_PAYLOAD; size *= 4)
+                ok = bench_payload(&json,&options,&fmu,instance,payload,size);
+            fmu.Terminate(instance);
+            fmu.FreeInstance(instance);
+        }
+        bench_unload_fmu(&fmu);
+    }
+
+    free(payload);
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
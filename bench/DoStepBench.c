@@ -0,0 +1,132 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * DoStep Throughput and Latency Benchmark
+ *
+ * Runs each test FMU through instantiation and initialization and
+ * then times every single fmi3DoStep call of a long run, reporting
+ * overall steps/s as well as latency percentiles and a log2-bucketed
+ * latency histogram, since tail latency is what matters for hard
+ * real-time use.
+ */
+
+#define BENCH_DEFAULT_STEPS 1000000
+#define BENCH_WARMUP_STEPS 1000
+#define BENCH_STEP_SIZE 0.001
+#define BENCH_HISTOGRAM_BUCKETS 40
+
+static int bench_steps(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, fmi3Instance instance)
+{
+    size_t steps = options->count ? options->count : BENCH_DEFAULT_STEPS;
+    size_t histogram[BENCH_HISTOGRAM_BUCKETS] = { 0 };
+    double* latencies = malloc(steps*sizeof(double));
+    double time = 0.0, start, total, sum = 0.0;
+    fmi3Boolean eventHandlingNeeded, terminateSimulation, earlyReturn;
+    fmi3Float64 lastSuccessfulTime;
+    size_t i;
+
+    if (latencies == NULL) {
+        fprintf(stderr,"%s: cannot allocate latency buffer for %zu steps\n",fmu->name,steps);
+        return 0;
+    }
+
+    for (i = 0; i<BENCH_WARMUP_STEPS; i++, time += BENCH_STEP_SIZE)
+        fmu->DoStep(instance,time,BENCH_STEP_SIZE,fmi3True,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&lastSuccessfulTime);
+
+    start = bench_now_ns();
+    for (i = 0; i<steps; i++, time += BENCH_STEP_SIZE) {
+        double before = bench_now_ns();
+        if (fmu->DoStep(instance,time,BENCH_STEP_SIZE,fmi3True,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&lastSuccessfulTime) != fmi3OK) {
+            fprintf(stderr,"%s: fmi3DoStep failed at t=%g\n",fmu->name,time);
+            free(latencies);
+            return 0;
+        }
+        latencies[i] = bench_now_ns() - before;
+    }
+    total = bench_now_ns() - start;
+
+    for (i = 0; i<steps; i++) {
+        size_t bucket = 0;
+        double bound = 1.0;
+        while (latencies[i] >= bound * 2.0 && bucket < BENCH_HISTOGRAM_BUCKETS-1) {
+            bound *= 2.0;
+            bucket++;
+        }
+        histogram[bucket]++;
+        sum += latencies[i];
+    }
+    qsort(latencies,steps,sizeof(double),bench_compare_double);
+
+    bench_json_record(json,fmu->name);
+    bench_json_field(json,"function","\"fmi3DoStep\"");
+    bench_json_field(json,"steps","%zu",steps);
+    bench_json_field(json,"stepsPerSecond","%.0f",(double)steps*1e9/total);
+    bench_json_field(json,"meanNs","%.1f",sum/(double)steps);
+    bench_json_field(json,"minNs","%.0f",latencies[0]);
+    bench_json_field(json,"p50Ns","%.0f",bench_percentile(latencies,steps,0.50));
+    bench_json_field(json,"p99Ns","%.0f",bench_percentile(latencies,steps,0.99));
+    bench_json_field(json,"p999Ns","%.0f",bench_percentile(latencies,steps,0.999));
+    bench_json_field(json,"maxNs","%.0f",latencies[steps-1]);
+    /* Bucket k counts steps with latency in [2^k,2^(k+1)) ns */
+    fprintf(json->file,", \"histogramLog2Ns\": [");
+    for (i = 0; i<BENCH_HISTOGRAM_BUCKETS; i++)
+        fprintf(json->file,"%s%zu",i ? ", " : "",histogram[i]);
+    fprintf(json->file,"]");
+    bench_json_end_record(json);
+
+    fprintf(stderr,"%s: %.0f steps/s, p50 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns\n",
+        fmu->name,(double)steps*1e9/total,bench_percentile(latencies,steps,0.50),bench_percentile(latencies,steps,0.99),
+        bench_percentile(latencies,steps,0.999),latencies[steps-1]);
+
+    free(latencies);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = { NULL, 0.0, 0, 0, 0 };
+    BenchJSON json;
+    size_t t;
+    int ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"doStep"))
+        return 2;
+
+    for (t = 0; t<BENCH_TARGETS; t++) {
+        BenchFMU fmu;
+        fmi3Instance instance;
+
+        if (!bench_load_fmu(&fmu,&bench_targets[t])) {
+            ok = 0;
+            continue;
+        }
+        instance = bench_instantiate(&fmu,fmi3False);
+        if (instance == NULL) {
+            bench_unload_fmu(&fmu);
+            ok = 0;
+            continue;
+        }
+        if (0==strcmp(fmu.name,"DynamicArrayTest") && !bench_configure_dynamic_array(&fmu,instance,&options)) {
+            fprintf(stderr,"%s: reconfiguration failed\n",fmu.name);
+            ok = 0;
+        } else
+            ok &= bench_steps(&json,&options,&fmu,instance);
+
+        fmu.Terminate(instance);
+        fmu.FreeInstance(instance);
+        bench_unload_fmu(&fmu);
+    }
+
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
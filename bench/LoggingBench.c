@@ -0,0 +1,176 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * Logging Overhead Benchmark
+ *
+ * Measures the per-call cost of a scalar fmi3GetFloat64 and of
+ * fmi3DoStep for each test FMU with logging switched off, with
+ * logging on but the FMI category filtered out, with logging on for
+ * the PERF category only (timing each call into the performance
+ * counters), and with logging on for all categories.  The differences
+ * are only visible in builds with PUBLIC_LOGGING or PRIVATE_LOGGING
+ * (and VERBOSE_FMI_LOGGING for per-call messages); the host logger
+ * discards all non-error messages.
+ *
+ * A scalar fmi3GetFloat64 of an invalid value reference measures the
+ * error path, whose message is always formatted and printed by the
+ * host logger when delivered, so it is not timed with logging on for
+ * all categories.  Its rows also report the errors counted by the FMU
+ * via fmi3xGetErrorCounts over all calibration rounds.
+ */
+
+typedef enum {
+    LOGGING_OFF,
+    LOGGING_FILTERED,
+    LOGGING_PERF,
+    LOGGING_ON,
+    LOGGING_SCENARIOS
+} BenchScenario;
+
+static const char* const scenario_names[LOGGING_SCENARIOS] = { "off", "filtered", "perf", "on" };
+
+typedef enum {
+    CALL_GET_FLOAT64,
+    CALL_DO_STEP,
+    CALL_GET_INVALID,
+    CALLS
+} BenchCall;
+
+static const char* const call_names[CALLS] = { "fmi3GetFloat64", "fmi3DoStep", "fmi3GetFloat64(invalid)" };
+
+#define BENCH_STEP_SIZE 0.001
+
+static fmi3Status bench_set_scenario(const BenchFMU* fmu, fmi3Instance instance, BenchScenario scenario)
+{
+    static const fmi3String filtered[1] = { "BINARY" }, perf[1] = { "PERF" };
+    switch (scenario) {
+        case LOGGING_FILTERED:
+            return fmu->SetDebugLogging(instance,fmi3True,1,filtered);
+        case LOGGING_PERF:
+            return fmu->SetDebugLogging(instance,fmi3True,1,perf);
+        case LOGGING_ON:
+            return fmu->SetDebugLogging(instance,fmi3True,0,NULL);
+        default:
+            return fmu->SetDebugLogging(instance,fmi3False,0,NULL);
+    }
+}
+
+static void bench_call(const BenchFMU* fmu, fmi3Instance instance, BenchCall call, double* time)
+{
+    /* Time, which is value reference 45 in the simple FMUs and 0 in DynamicArrayTest */
+    static const fmi3ValueReference simple_time = 45, dynamic_time = 0, invalid = 100000;
+    fmi3Boolean eventHandlingNeeded, terminateSimulation, earlyReturn;
+    fmi3Float64 value;
+    if (call == CALL_DO_STEP) {
+        fmu->DoStep(instance,*time,BENCH_STEP_SIZE,fmi3False,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&value);
+        *time += BENCH_STEP_SIZE;
+    } else if (call == CALL_GET_INVALID) {
+        fmu->GetFloat64(instance,&invalid,1,&value,1);
+    } else {
+        fmu->GetFloat64(instance,(0==strcmp(fmu->name,"DynamicArrayTest")) ? &dynamic_time : &simple_time,1,&value,1);
+    }
+}
+
+/* Run one configuration, doubling the call count until min_time is reached */
+static double bench_run(const BenchOptions* options, const BenchFMU* fmu, fmi3Instance instance, BenchCall call, double* time, size_t* calls)
+{
+    double start, elapsed;
+    size_t i, iterations;
+    for (iterations = 1024;;iterations *= 2) {
+        start = bench_now_ns();
+        for (i = 0; i<iterations; i++)
+            bench_call(fmu,instance,call,time);
+        elapsed = bench_now_ns() - start;
+        if (elapsed >= options->min_time * 1e9)
+            break;
+    }
+    *calls = iterations;
+    return elapsed/(double)iterations;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = { NULL, 0.1, 0, 0, 0 };
+    BenchJSON json;
+    size_t t;
+    int ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"logging"))
+        return 2;
+
+    for (t = 0; t<BENCH_TARGETS; t++) {
+        BenchFMU fmu;
+        fmi3xGetErrorCountsTYPE* GetErrorCounts;
+        fmi3Instance instance;
+        double time = 0.0;
+        int call, scenario;
+
+        if (!bench_load_fmu(&fmu,&bench_targets[t])) {
+            ok = 0;
+            continue;
+        }
+        instance = bench_instantiate(&fmu,fmi3False);
+        if (instance == NULL) {
+            bench_unload_fmu(&fmu);
+            ok = 0;
+            continue;
+        }
+        GetErrorCounts = (fmi3xGetErrorCountsTYPE*)bench_library_symbol(fmu.library,"fmi3xGetErrorCounts");
+
+        for (call = 0; call<CALLS; call++) {
+            double baseline = 0.0;
+            for (scenario = 0; scenario<LOGGING_SCENARIOS; scenario++) {
+                fmi3UInt64 before[FMI3X_ERROR_KINDS] = { 0 }, after[FMI3X_ERROR_KINDS] = { 0 };
+                size_t calls;
+                double ns;
+                if (call == CALL_GET_INVALID && scenario == LOGGING_ON)
+                    continue;
+                if (bench_set_scenario(&fmu,instance,(BenchScenario)scenario) != fmi3OK) {
+                    fprintf(stderr,"%s: fmi3SetDebugLogging failed\n",fmu.name);
+                    ok = 0;
+                    break;
+                }
+                if (GetErrorCounts != NULL)
+                    GetErrorCounts(instance,before,FMI3X_ERROR_KINDS);
+                ns = bench_run(&options,&fmu,instance,(BenchCall)call,&time,&calls);
+                if (GetErrorCounts != NULL)
+                    GetErrorCounts(instance,after,FMI3X_ERROR_KINDS);
+                if (scenario == LOGGING_OFF)
+                    baseline = ns;
+                bench_json_record(&json,fmu.name);
+                bench_json_field(&json,"function","\"%s\"",call_names[call]);
+                bench_json_field(&json,"logging","\"%s\"",scenario_names[scenario]);
+                bench_json_field(&json,"calls","%zu",calls);
+                bench_json_field(&json,"nsPerCall","%.2f",ns);
+                bench_json_field(&json,"overheadNs","%.2f",ns-baseline);
+                if (call == CALL_GET_INVALID && GetErrorCounts != NULL) {
+                    fmi3UInt64 errors = 0;
+                    int kind;
+                    for (kind = 0; kind<FMI3X_ERROR_KINDS; kind++)
+                        errors += after[kind] - before[kind];
+                    bench_json_field(&json,"errorsCounted","%llu",(unsigned long long)errors);
+                }
+                bench_json_end_record(&json);
+                fprintf(stderr,"%s: %s: logging %s: %.1f ns/call (%+.1f ns)\n",
+                    fmu.name,call_names[call],scenario_names[scenario],ns,ns-baseline);
+            }
+        }
+
+        fmu.Terminate(instance);
+        fmu.FreeInstance(instance);
+        bench_unload_fmu(&fmu);
+    }
+
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * Reconfiguration Latency Benchmark
+ *
+ * Times complete reconfigurations of DynamicArrayTest (enter
+ * configuration mode, set XSize/YSize, exit configuration mode) for
+ * the size patterns typical of parameter sweeps: reconfiguring to the
+ * same size, alternating between a size and half of it, and sweeping
+ * YSize up and down between 1 and its maximum.
+ */
+
+#define BENCH_DEFAULT_RECONFIGURATIONS 10000
+#define BENCH_DEFAULT_X_SIZE 1000
+#define BENCH_DEFAULT_Y_SIZE 100
+
+typedef enum {
+    SCENARIO_SAME,
+    SCENARIO_SHRINK_GROW,
+    SCENARIO_SWEEP,
+    SCENARIOS
+} BenchScenario;
+
+static const char* const scenario_names[SCENARIOS] = { "same", "shrinkGrow", "sweep" };
+
+/* YSize for reconfiguration i of the given scenario */
+static fmi3UInt64 scenario_y_size(BenchScenario scenario, size_t i, fmi3UInt64 y_size)
+{
+    fmi3UInt64 period, phase;
+    switch (scenario) {
+        case SCENARIO_SHRINK_GROW:
+            return (i % 2) ? (y_size+1)/2 : y_size;
+        case SCENARIO_SWEEP:
+            if (y_size < 2)
+                return y_size;
+            period = 2*(y_size-1);
+            phase = (fmi3UInt64)i % period;
+            return 1 + ((phase < y_size) ? phase : period-phase);
+        default:
+            return y_size;
+    }
+}
+
+static int bench_reconfigure(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, BenchScenario scenario)
+{
+    const fmi3ValueReference vrs[2] = { 1, 2 };
+    size_t count = options->count ? options->count : BENCH_DEFAULT_RECONFIGURATIONS;
+    fmi3UInt64 x_size = options->x_size ? options->x_size : BENCH_DEFAULT_X_SIZE;
+    fmi3UInt64 y_size = options->y_size ? options->y_size : BENCH_DEFAULT_Y_SIZE;
+    double* latencies = malloc(count*sizeof(double));
+    double sum = 0.0;
+    fmi3Instance instance;
+    size_t i;
+
+    if (latencies == NULL) {
+        fprintf(stderr,"%s: cannot allocate latency buffer for %zu reconfigurations\n",fmu->name,count);
+        return 0;
+    }
+    instance = bench_instantiate(fmu,fmi3False);
+    if (instance == NULL) {
+        free(latencies);
+        return 0;
+    }
+
+    for (i = 0; i<count; i++) {
+        fmi3UInt64 sizes[2];
+        double before;
+        sizes[0] = x_size;
+        sizes[1] = scenario_y_size(scenario,i,y_size);
+        before = bench_now_ns();
+        if (fmu->EnterConfigurationMode(instance) != fmi3OK ||
+            fmu->SetUInt64(instance,vrs,2,sizes,2) != fmi3OK ||
+            fmu->ExitConfigurationMode(instance) != fmi3OK) {
+            fprintf(stderr,"%s: reconfiguration to %llux%llu failed\n",fmu->name,(unsigned long long)sizes[0],(unsigned long long)sizes[1]);
+            fmu->FreeInstance(instance);
+            free(latencies);
+            return 0;
+        }
+        latencies[i] = bench_now_ns() - before;
+        sum += latencies[i];
+    }
+
+    fmu->Terminate(instance);
+    fmu->FreeInstance(instance);
+
+    qsort(latencies,count,sizeof(double),bench_compare_double);
+
+    bench_json_record(json,fmu->name);
+    bench_json_field(json,"function","\"fmi3ExitConfigurationMode\"");
+    bench_json_field(json,"scenario","\"%s\"",scenario_names[scenario]);
+    bench_json_field(json,"xSize","%llu",(unsigned long long)x_size);
+    bench_json_field(json,"maxYSize","%llu",(unsigned long long)y_size);
+    bench_json_field(json,"reconfigurations","%zu",count);
+    bench_json_field(json,"meanNs","%.1f",sum/(double)count);
+    bench_json_field(json,"p50Ns","%.0f",bench_percentile(latencies,count,0.50));
+    bench_json_field(json,"p99Ns","%.0f",bench_percentile(latencies,count,0.99));
+    bench_json_field(json,"maxNs","%.0f",latencies[count-1]);
+    bench_json_end_record(json);
+
+    fprintf(stderr,"%s: %s: mean %.0f ns, p50 %.0f ns, p99 %.0f ns, max %.0f ns\n",
+        fmu->name,scenario_names[scenario],sum/(double)count,bench_percentile(latencies,count,0.50),
+        bench_percentile(latencies,count,0.99),latencies[count-1]);
+
+    free(latencies);
+    return 1;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = { NULL, 0.0, 0, 0, 0 };
+    BenchJSON json;
+    BenchFMU fmu;
+    size_t t;
+    int scenario, ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"reconfigure"))
+        return 2;
+
+    for (t = 0; t<BENCH_TARGETS; t++)
+        if (0==strcmp(bench_targets[t].name,"DynamicArrayTest"))
+            break;
+
+    if (t == BENCH_TARGETS || !bench_load_fmu(&fmu,&bench_targets[t])) {
+        bench_json_close(&json);
+        return 1;
+    }
+
+    for (scenario = 0; scenario<SCENARIOS; scenario++)
+        ok &= bench_reconfigure(&json,&options,&fmu,(BenchScenario)scenario);
+
+    bench_unload_fmu(&fmu);
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
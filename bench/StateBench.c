@@ -0,0 +1,245 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "BenchUtil.h"
+
+/*
+ * FMU State Save/Restore Benchmark
+ *
+ * Times the rollback pattern of optimizers and master algorithms for
+ * each test FMU: save the state with fmi3GetFMUState, take a step,
+ * restore the state with fmi3SetFMUState and release it again with
+ * fmi3FreeFMUState.  The "overwrite" mode instead keeps one state and
+ * passes it back to fmi3GetFMUState to be overwritten.  A separate
+ * record times fmi3SerializeFMUState and fmi3DeserializeFMUState of a
+ * saved state into a preallocated buffer and a reused state.
+ */
+
+#define BENCH_DEFAULT_ROUNDS 100000
+#define BENCH_WARMUP_ROUNDS 100
+#define BENCH_STEP_SIZE 0.001
+
+typedef enum {
+    MODE_POOLED,
+    MODE_OVERWRITE,
+    MODES
+} BenchMode;
+
+static const char* const mode_names[MODES] = { "pooled", "overwrite" };
+
+typedef struct {
+    double* save;
+    double* restore;
+    double* release;
+} BenchLatencies;
+
+static void bench_report(BenchJSON* json, const char* name, double* latencies, size_t count)
+{
+    char field[64];
+    qsort(latencies,count,sizeof(double),bench_compare_double);
+    sprintf(field,"%sP50Ns",name);
+    bench_json_field(json,field,"%.0f",bench_percentile(latencies,count,0.50));
+    sprintf(field,"%sP99Ns",name);
+    bench_json_field(json,field,"%.0f",bench_percentile(latencies,count,0.99));
+}
+
+static int bench_round(const BenchFMU* fmu, fmi3Instance instance, BenchMode mode, fmi3FMUState* state, double* time, double* save, double* restore, double* release)
+{
+    fmi3Boolean eventHandlingNeeded, terminateSimulation, earlyReturn;
+    fmi3Float64 lastSuccessfulTime;
+    double t0, t1, t2, t3;
+
+    if (mode == MODE_POOLED)
+        *state = NULL;
+    t0 = bench_now_ns();
+    if (fmu->GetFMUState(instance,state) != fmi3OK)
+        return 0;
+    t1 = bench_now_ns();
+    fmu->DoStep(instance,*time,BENCH_STEP_SIZE,fmi3False,&eventHandlingNeeded,&terminateSimulation,&earlyReturn,&lastSuccessfulTime);
+    t2 = bench_now_ns();
+    if (fmu->SetFMUState(instance,*state) != fmi3OK)
+        return 0;
+    t3 = bench_now_ns();
+    if (mode == MODE_POOLED && fmu->FreeFMUState(instance,state) != fmi3OK)
+        return 0;
+    *release = bench_now_ns() - t3;
+    *save = t1 - t0;
+    *restore = t3 - t2;
+    *time += BENCH_STEP_SIZE;
+    return 1;
+}
+
+static int bench_states(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, fmi3Instance instance, BenchMode mode)
+{
+    size_t rounds = options->count ? options->count : BENCH_DEFAULT_ROUNDS;
+    BenchLatencies latencies;
+    fmi3FMUState state = NULL;
+    double time = 0.0, dummy;
+    size_t i;
+    int ok = 1;
+
+    latencies.save = malloc(rounds*sizeof(double));
+    latencies.restore = malloc(rounds*sizeof(double));
+    latencies.release = malloc(rounds*sizeof(double));
+    if (latencies.save == NULL || latencies.restore == NULL || latencies.release == NULL) {
+        fprintf(stderr,"%s: cannot allocate latency buffers for %zu rounds\n",fmu->name,rounds);
+        ok = 0;
+    }
+
+    for (i = 0; ok && i<BENCH_WARMUP_ROUNDS; i++)
+        ok = bench_round(fmu,instance,mode,&state,&time,&dummy,&dummy,&dummy);
+    for (i = 0; ok && i<rounds; i++)
+        ok = bench_round(fmu,instance,mode,&state,&time,&latencies.save[i],&latencies.restore[i],&latencies.release[i]);
+    if (!ok)
+        fprintf(stderr,"%s: FMU state save/restore failed\n",fmu->name);
+
+    if (state != NULL)
+        fmu->FreeFMUState(instance,&state);
+
+    if (ok) {
+        double sum = 0.0;
+        for (i = 0; i<rounds; i++)
+            sum += latencies.save[i] + latencies.restore[i];
+        bench_json_record(json,fmu->name);
+        bench_json_field(json,"function","\"fmi3GetFMUState+fmi3SetFMUState\"");
+        bench_json_field(json,"mode","\"%s\"",mode_names[mode]);
+        bench_json_field(json,"rounds","%zu",rounds);
+        bench_json_field(json,"saveRestoreMeanNs","%.1f",sum/(double)rounds);
+        bench_report(json,"save",latencies.save,rounds);
+        bench_report(json,"restore",latencies.restore,rounds);
+        if (mode == MODE_POOLED)
+            bench_report(json,"free",latencies.release,rounds);
+        bench_json_end_record(json);
+        fprintf(stderr,"%s: %s: save+restore mean %.0f ns, save p50 %.0f ns, restore p50 %.0f ns\n",
+            fmu->name,mode_names[mode],sum/(double)rounds,bench_percentile(latencies.save,rounds,0.50),
+            bench_percentile(latencies.restore,rounds,0.50));
+    }
+
+    free(latencies.save);
+    free(latencies.restore);
+    free(latencies.release);
+    return ok;
+}
+
+static int bench_serialize(BenchJSON* json, const BenchOptions* options, const BenchFMU* fmu, fmi3Instance instance)
+{
+    size_t rounds = options->count ? options->count : BENCH_DEFAULT_ROUNDS;
+    BenchLatencies latencies;
+    fmi3FMUState state = NULL, copy = NULL;
+    fmi3Byte* buffer = NULL;
+    size_t size = 0, i;
+    int ok = 1;
+
+    latencies.save = malloc(rounds*sizeof(double));
+    latencies.restore = malloc(rounds*sizeof(double));
+    latencies.release = NULL;
+    if (latencies.save == NULL || latencies.restore == NULL) {
+        fprintf(stderr,"%s: cannot allocate latency buffers for %zu rounds\n",fmu->name,rounds);
+        ok = 0;
+    }
+    if (ok && (fmu->GetFMUState(instance,&state) != fmi3OK || fmu->SerializedFMUStateSize(instance,state,&size) != fmi3OK)) {
+        fprintf(stderr,"%s: FMU state save failed\n",fmu->name);
+        ok = 0;
+    }
+    if (ok && (buffer = malloc(size)) == NULL) {
+        fprintf(stderr,"%s: cannot allocate %zu byte serialization buffer\n",fmu->name,size);
+        ok = 0;
+    }
+
+    for (i = 0; ok && i<BENCH_WARMUP_ROUNDS+rounds; i++) {
+        double t0, t1, t2;
+        t0 = bench_now_ns();
+        if (fmu->SerializeFMUState(instance,state,buffer,size) != fmi3OK) {
+            ok = 0;
+            break;
+        }
+        t1 = bench_now_ns();
+        if (fmu->DeserializeFMUState(instance,buffer,size,&copy) != fmi3OK) {
+            ok = 0;
+            break;
+        }
+        t2 = bench_now_ns();
+        if (i >= BENCH_WARMUP_ROUNDS) {
+            latencies.save[i-BENCH_WARMUP_ROUNDS] = t1 - t0;
+            latencies.restore[i-BENCH_WARMUP_ROUNDS] = t2 - t1;
+        }
+    }
+    if (!ok && buffer != NULL)
+        fprintf(stderr,"%s: FMU state serialization failed\n",fmu->name);
+
+    if (copy != NULL)
+        fmu->FreeFMUState(instance,&copy);
+    if (state != NULL)
+        fmu->FreeFMUState(instance,&state);
+
+    if (ok) {
+        double sum = 0.0;
+        for (i = 0; i<rounds; i++)
+            sum += latencies.save[i] + latencies.restore[i];
+        bench_json_record(json,fmu->name);
+        bench_json_field(json,"function","\"fmi3SerializeFMUState+fmi3DeserializeFMUState\"");
+        bench_json_field(json,"rounds","%zu",rounds);
+        bench_json_field(json,"bytes","%zu",size);
+        bench_json_field(json,"roundTripMeanNs","%.1f",sum/(double)rounds);
+        bench_report(json,"serialize",latencies.save,rounds);
+        bench_report(json,"deserialize",latencies.restore,rounds);
+        bench_json_end_record(json);
+        fprintf(stderr,"%s: %zu bytes: serialize+deserialize mean %.0f ns, serialize p50 %.0f ns, deserialize p50 %.0f ns\n",
+            fmu->name,size,sum/(double)rounds,bench_percentile(latencies.save,rounds,0.50),
+            bench_percentile(latencies.restore,rounds,0.50));
+    }
+
+    free(buffer);
+    free(latencies.save);
+    free(latencies.restore);
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options = { NULL, 0.0, 0, 0, 0 };
+    BenchJSON json;
+    size_t t;
+    int mode, ok = 1;
+
+    if (!bench_parse_options(&options,argc,argv) || !bench_json_open(&json,options.output,"fmuState"))
+        return 2;
+
+    for (t = 0; t<BENCH_TARGETS; t++) {
+        BenchFMU fmu;
+        fmi3Instance instance;
+
+        if (!bench_load_fmu(&fmu,&bench_targets[t])) {
+            ok = 0;
+            continue;
+        }
+        instance = bench_instantiate(&fmu,fmi3False);
+        if (instance == NULL) {
+            bench_unload_fmu(&fmu);
+            ok = 0;
+            continue;
+        }
+        if (0==strcmp(fmu.name,"DynamicArrayTest") && !bench_configure_dynamic_array(&fmu,instance,&options)) {
+            fprintf(stderr,"%s: reconfiguration failed\n",fmu.name);
+            ok = 0;
+        } else {
+            for (mode = 0; mode<MODES; mode++)
+                ok &= bench_states(&json,&options,&fmu,instance,(BenchMode)mode);
+            ok &= bench_serialize(&json,&options,&fmu,instance);
+        }
+
+        fmu.Terminate(instance);
+        fmu.FreeInstance(instance);
+        bench_unload_fmu(&fmu);
+    }
+
+    bench_json_close(&json);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ACCESS_PLAN_H
+#define ACCESS_PLAN_H
+
+/*
+ * Prepared Access Plans
+ *
+ * The plans behind fmi3xPrepareAccess (see VendorExtensions.h): the
+ * FMU checks the value references and adds the storage each of them
+ * covers with plan_add, in order, which merges adjacent storage into
+ * one span.  plan_get and plan_set then copy span by span between the
+ * storage and the packed values of the host.  The plans of an
+ * instance are kept on a list, so that they are freed with it.
+ *
+ * Requires CommonUtil.h to be included beforehand.
+ */
+
+typedef struct {
+    fmi3Byte* data;
+    size_t size;
+} AccessSpan;
+
+struct fmi3xAccessPlanStruct {
+    struct fmi3xAccessPlanStruct* next;
+    const void* owner;
+    fmi3Boolean set;
+    /* For the FMU: e.g. what to update after the plan was set */
+    unsigned int flags;
+    fmi3UInt64 generation;
+    size_t nValues;
+    size_t nSpans;
+    AccessSpan* spans;
+};
+
+/* A plan with room for maxSpans spans, allocated in one block */
+static fmi3xAccessPlan plan_alloc(const void* owner, fmi3Boolean set, size_t maxSpans)
+{
+    fmi3xAccessPlan plan = malloc(sizeof(struct fmi3xAccessPlanStruct) + maxSpans*sizeof(AccessSpan));
+    if (plan == NULL)
+        return NULL;
+    plan->next = NULL;
+    plan->owner = owner;
+    plan->set = set;
+    plan->flags = 0;
+    plan->generation = 0;
+    plan->nValues = 0;
+    plan->nSpans = 0;
+    plan->spans = (AccessSpan*)(plan+1);
+    return plan;
+}
+
+/* Add count values of storage, extending the last span if adjacent */
+static FMU_INLINE void plan_add(fmi3xAccessPlan plan, void* data, size_t count, size_t size)
+{
+    AccessSpan* last = plan->nSpans > 0 ? &plan->spans[plan->nSpans-1] : NULL;
+    plan->nValues += count;
+    if (count == 0)
+        return;
+    if (last != NULL && last->data + last->size == (fmi3Byte*)data) {
+        last->size += count*size;
+    } else {
+        plan->spans[plan->nSpans].data = data;
+        plan->spans[plan->nSpans].size = count*size;
+        plan->nSpans++;
+    }
+}
+
+/*
+ * Spans of up to 64 bytes, e.g. of scattered or repeated value
+ * references, are copied inline as two possibly overlapping fixed
+ * size copies, as the call of a generic memcpy would cost more than
+ * the copy itself.
+ */
+static FMU_INLINE void span_copy(fmi3Byte* to, const fmi3Byte* from, size_t size)
+{
+    if (size >= 8) {
+        if (size <= 16) {
+            memcpy(to,from,8);
+            memcpy(to+size-8,from+size-8,8);
+        } else if (size <= 32) {
+            memcpy(to,from,16);
+            memcpy(to+size-16,from+size-16,16);
+        } else if (size <= 64) {
+            memcpy(to,from,32);
+            memcpy(to+size-32,from+size-32,32);
+        } else {
+            memcpy(to,from,size);
+        }
+    } else if (size >= 4) {
+        memcpy(to,from,4);
+        memcpy(to+size-4,from+size-4,4);
+    } else if (size >= 2) {
+        memcpy(to,from,2);
+        memcpy(to+size-2,from+size-2,2);
+    } else if (size > 0) {
+        *to = *from;
+    }
+}
+
+/* The spans are walked with locals, as the copies may alias the plan */
+static FMU_INLINE void plan_get(fmi3xAccessPlan plan, void* values)
+{
+    const AccessSpan* span = plan->spans;
+    const AccessSpan* end = span + plan->nSpans;
+    fmi3Byte* out = values;
+    for (; span<end; span++) {
+        span_copy(out,span->data,span->size);
+        out += span->size;
+    }
+}
+
+static FMU_INLINE void plan_set(fmi3xAccessPlan plan, const void* values)
+{
+    const AccessSpan* span = plan->spans;
+    const AccessSpan* end = span + plan->nSpans;
+    const fmi3Byte* in = values;
+    for (; span<end; span++) {
+        span_copy(span->data,in,span->size);
+        in += span->size;
+    }
+}
+
+/*
+ * Return why plan cannot be executed by owner for getting or setting
+ * nValues values, or NULL if it can.  As with FMU states, a plan that
+ * was already freed cannot be told apart.
+ */
+static FMU_INLINE const char* plan_check(const void* owner, fmi3xAccessPlan plan, fmi3Boolean set, size_t nValues)
+{
+    if (plan == NULL || plan->owner != owner)
+        return "Invalid prepared access plan: Not prepared by this instance.";
+    if (plan->set != set)
+        return set ? "Prepared access plan was prepared for getting, not setting." : "Prepared access plan was prepared for setting, not getting.";
+    if (plan->nValues != nValues)
+        return "nValues is not equal to the number of values of the prepared access plan.";
+    return NULL;
+}
+
+static FMU_INLINE void plan_link(fmi3xAccessPlan* plans, fmi3xAccessPlan plan)
+{
+    plan->next = *plans;
+    *plans = plan;
+}
+
+/* Unlink and free plan, returning 0 if it is not on the list */
+static int plan_free(fmi3xAccessPlan* plans, fmi3xAccessPlan plan)
+{
+    while (*plans != NULL && *plans != plan)
+        plans = &(*plans)->next;
+    if (*plans == NULL || plan == NULL)
+        return 0;
+    *plans = plan->next;
+    free(plan);
+    return 1;
+}
+
+static void plan_free_all(fmi3xAccessPlan* plans)
+{
+    while (*plans != NULL) {
+        fmi3xAccessPlan next = (*plans)->next;
+        free(*plans);
+        *plans = next;
+    }
+}
+
+#endif /* ACCESS_PLAN_H */
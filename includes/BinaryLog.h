@@ -0,0 +1,398 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+/*
+ * Deferred-format Binary Logging
+ *
+ * With PRIVATE_LOG_BINARY, instance log messages are not formatted
+ * for the private log file.  Instead each message is recorded into a
+ * per-instance buffer as its format string address, a timestamp and
+ * the raw arguments, and the buffer is appended to the file at
+ * PRIVATE_BINARY_LOG_PATH whenever it fills up and when the instance
+ * is freed.  The BinaryLogDecoder tool renders such files to text.
+ *
+ * The file is a sequence of chunks in host byte order, each written
+ * with a single unbuffered write:
+ *
+ *   uint32 magic, uint32 length of the rest of the chunk,
+ *   uint64 instance address, uint64 ticks + uint64 nanoseconds at
+ *   instantiation, uint64 ticks + uint64 nanoseconds at the write,
+ *   uint16 length + model name, uint16 length + instance name,
+ *   records...
+ *
+ * A format record (uint8 type 1, uint64 format id, uint16 length +
+ * format string) defines a format id, and is emitted by each instance
+ * before its first message using that format.  A message record is
+ * uint8 type 2, uint8 category, uint64 timestamp in ticks, uint64
+ * format id, followed by one value per conversion of the format (and
+ * per '*' width/precision): 8 byte integers, doubles and pointers,
+ * and strings as uint16 length + characters, truncated to at most
+ * BINARY_LOG_MAX_STRING characters.  Ticks are TSC cycles on x86 and
+ * nanoseconds elsewhere, the decoder converts them with the two pairs
+ * of the chunk header.
+ *
+ * Each instance parses a format into the sequence of its argument
+ * types only once, so recording a message is a handful of va_arg
+ * calls and stores.  Formats with more than BINARY_LOG_MAX_ARGS
+ * arguments are not recorded.
+ *
+ * The format parser is shared with the decoder, the recording side
+ * is only available with PRIVATE_LOG_BINARY.  Requires CommonUtil.h
+ * to be included beforehand.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define BINARY_LOG_CHUNK_MAGIC 0x434C4250u /* "PBLC" */
+#define BINARY_LOG_RECORD_FORMAT 1
+#define BINARY_LOG_RECORD_MESSAGE 2
+#define BINARY_LOG_MAX_STRING 1023
+
+typedef enum {
+    BINARY_LOG_ARG_NONE,
+    BINARY_LOG_ARG_INT,
+    BINARY_LOG_ARG_UINT,
+    BINARY_LOG_ARG_DOUBLE,
+    BINARY_LOG_ARG_POINTER,
+    BINARY_LOG_ARG_STRING
+} BinaryLogArgument;
+
+/* One printf conversion: format[start..end) is the complete specification */
+typedef struct {
+    size_t start;
+    size_t end;
+    int stars;
+    char length[3];
+    char conversion;
+    BinaryLogArgument argument;
+} BinaryLogConversion;
+
+/*
+ * Find the next conversion from position in format, returning 0 at
+ * the end of the format.  "%%" is returned as a conversion without
+ * argument, '%' followed by an unknown conversion is treated as
+ * literal text.
+ */
+static FMU_INLINE int binary_log_next_conversion(const char* format, size_t position, BinaryLogConversion* conversion)
+{
+    size_t i, n;
+    for (i = position; format[i] != '\0'; i++) {
+        if (format[i] != '%')
+            continue;
+        conversion->start = i++;
+        conversion->stars = 0;
+        while (format[i] != '\0' && strchr("-+ #0",format[i]) != NULL)
+            i++;
+        if (format[i] == '*') {
+            conversion->stars++;
+            i++;
+        }
+        while (format[i] >= '0' && format[i] <= '9')
+            i++;
+        if (format[i] == '.') {
+            i++;
+            if (format[i] == '*') {
+                conversion->stars++;
+                i++;
+            }
+            while (format[i] >= '0' && format[i] <= '9')
+                i++;
+        }
+        for (n = 0; n<2 && format[i] != '\0' && strchr("hlLqjzt",format[i]) != NULL; n++)
+            conversion->length[n] = format[i++];
+        conversion->length[n] = '\0';
+        conversion->conversion = format[i];
+        switch (format[i]) {
+            case '%':
+                conversion->argument = BINARY_LOG_ARG_NONE;
+                break;
+            case 'd': case 'i': case 'c':
+                conversion->argument = BINARY_LOG_ARG_INT;
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                conversion->argument = BINARY_LOG_ARG_UINT;
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                conversion->argument = BINARY_LOG_ARG_DOUBLE;
+                break;
+            case 'p': case 'n':
+                conversion->argument = BINARY_LOG_ARG_POINTER;
+                break;
+            case 's':
+                conversion->argument = BINARY_LOG_ARG_STRING;
+                break;
+            default:
+                /* Unknown or truncated conversion, take the '%' literally */
+                if (format[i] == '\0')
+                    return 0;
+                continue;
+        }
+        conversion->end = i+1;
+        return 1;
+    }
+    return 0;
+}
+
+#ifdef PRIVATE_LOG_BINARY
+
+#ifndef PRIVATE_LOG_PATH
+#error "PRIVATE_LOG_BINARY requires PRIVATE_LOG_PATH"
+#endif
+
+#define PRIVATE_BINARY_LOG_PATH PRIVATE_LOG_PATH ".bin"
+
+#ifndef BINARY_LOG_BUFFER_SIZE
+#define BINARY_LOG_BUFFER_SIZE 65536
+#endif
+/* Largest message record, longer string arguments are cut */
+#define BINARY_LOG_MAX_RECORD 4096
+#define BINARY_LOG_MAX_ARGS 32
+#define BINARY_LOG_FORMAT_SLOTS 256
+/* Room that must be left in the buffer before recording a message */
+#define BINARY_LOG_RECORD_RESERVE (BINARY_LOG_MAX_STRING + 16 + BINARY_LOG_MAX_RECORD + 8*BINARY_LOG_MAX_ARGS)
+#define BINARY_LOG_NAMES_OFFSET 48
+
+/* How each argument is fetched with va_arg */
+typedef enum {
+    BINARY_LOG_VA_INT,
+    BINARY_LOG_VA_LONG,
+    BINARY_LOG_VA_LLONG,
+    BINARY_LOG_VA_UINT,
+    BINARY_LOG_VA_ULONG,
+    BINARY_LOG_VA_ULLONG,
+    BINARY_LOG_VA_SIZE,
+    BINARY_LOG_VA_INTMAX,
+    BINARY_LOG_VA_UINTMAX,
+    BINARY_LOG_VA_PTRDIFF,
+    BINARY_LOG_VA_DOUBLE,
+    BINARY_LOG_VA_LDOUBLE,
+    BINARY_LOG_VA_POINTER,
+    BINARY_LOG_VA_STRING
+} BinaryLogVaType;
+
+typedef struct {
+    const char* format;
+    fmi3UInt8 count;
+    fmi3UInt8 types[BINARY_LOG_MAX_ARGS];
+} BinaryLogFormat;
+
+struct BinaryLog {
+    FILE* file;
+    const char* model_name;
+    const char* instance_name;
+    const void* instance;
+    fmi3UInt64 open_ticks;
+    fmi3UInt64 open_ns;
+    size_t used;
+    /* Formats already defined in this instance's stream, hashed by address */
+    BinaryLogFormat formats[BINARY_LOG_FORMAT_SLOTS];
+    fmi3Byte buffer[BINARY_LOG_BUFFER_SIZE];
+};
+
+static FMU_INLINE fmi3Byte* binary_log_put(fmi3Byte* out, const void* value, size_t size)
+{
+    memcpy(out,value,size);
+    return out+size;
+}
+
+static FMU_INLINE fmi3Byte* binary_log_put_string(fmi3Byte* out, const char* value, size_t limit)
+{
+    size_t length = strlen(value);
+    fmi3UInt16 stored = (fmi3UInt16)((length < limit) ? length : limit);
+    out = binary_log_put(out,&stored,sizeof(stored));
+    return binary_log_put(out,value,stored);
+}
+
+/* Parse format into the va_arg types of its arguments, 0 if there are too many */
+static FMU_INLINE int binary_log_signature(const char* format, BinaryLogFormat* signature)
+{
+    BinaryLogConversion conversion;
+    size_t position = 0;
+    signature->format = format;
+    signature->count = 0;
+    while (binary_log_next_conversion(format,position,&conversion)) {
+        const char* length = conversion.length;
+        int star, type;
+        position = conversion.end;
+        if (signature->count + conversion.stars + 1 > BINARY_LOG_MAX_ARGS)
+            return 0;
+        for (star = 0; star<conversion.stars; star++)
+            signature->types[signature->count++] = BINARY_LOG_VA_INT;
+        switch (conversion.argument) {
+            case BINARY_LOG_ARG_INT:
+            case BINARY_LOG_ARG_UINT: {
+                int is_signed = (conversion.argument == BINARY_LOG_ARG_INT);
+                if (0==strcmp(length,"ll") || 0==strcmp(length,"q"))
+                    type = is_signed ? BINARY_LOG_VA_LLONG : BINARY_LOG_VA_ULLONG;
+                else if (0==strcmp(length,"l"))
+                    type = is_signed ? BINARY_LOG_VA_LONG : BINARY_LOG_VA_ULONG;
+                else if (0==strcmp(length,"z"))
+                    type = BINARY_LOG_VA_SIZE;
+                else if (0==strcmp(length,"j"))
+                    type = is_signed ? BINARY_LOG_VA_INTMAX : BINARY_LOG_VA_UINTMAX;
+                else if (0==strcmp(length,"t"))
+                    type = BINARY_LOG_VA_PTRDIFF;
+                else
+                    type = is_signed ? BINARY_LOG_VA_INT : BINARY_LOG_VA_UINT;
+                break;
+            }
+            case BINARY_LOG_ARG_DOUBLE:
+                type = (0==strcmp(length,"L")) ? BINARY_LOG_VA_LDOUBLE : BINARY_LOG_VA_DOUBLE;
+                break;
+            case BINARY_LOG_ARG_POINTER:
+                type = BINARY_LOG_VA_POINTER;
+                break;
+            case BINARY_LOG_ARG_STRING:
+                type = BINARY_LOG_VA_STRING;
+                break;
+            default:
+                continue;
+        }
+        signature->types[signature->count++] = (fmi3UInt8)type;
+    }
+    return 1;
+}
+
+static FMU_INLINE void binary_log_begin_chunk(struct BinaryLog* log)
+{
+    fmi3Byte* out = log->buffer + BINARY_LOG_NAMES_OFFSET;
+    fmi3UInt32 magic = BINARY_LOG_CHUNK_MAGIC;
+    fmi3UInt64 instance = (fmi3UInt64)(size_t)log->instance;
+    memcpy(log->buffer,&magic,sizeof(magic));
+    memcpy(log->buffer+8,&instance,sizeof(instance));
+    memcpy(log->buffer+16,&log->open_ticks,sizeof(log->open_ticks));
+    memcpy(log->buffer+24,&log->open_ns,sizeof(log->open_ns));
+    out = binary_log_put_string(out,log->model_name,255);
+    out = binary_log_put_string(out,log->instance_name,255);
+    log->used = (size_t)(out - log->buffer);
+}
+
+static FMU_INLINE void binary_log_flush(struct BinaryLog* log)
+{
+    fmi3UInt32 length = (fmi3UInt32)(log->used - 2*sizeof(fmi3UInt32));
+    fmi3UInt64 ticks = fmu_ticks(), ns = fmu_now_ns();
+    memcpy(log->buffer+4,&length,sizeof(length));
+    memcpy(log->buffer+32,&ticks,sizeof(ticks));
+    memcpy(log->buffer+40,&ns,sizeof(ns));
+    fwrite(log->buffer,1,log->used,log->file);
+    binary_log_begin_chunk(log);
+}
+
+static FMU_INLINE struct BinaryLog* binary_log_open(const char* model_name, const char* instance_name, const void* instance)
+{
+    struct BinaryLog* log = calloc(1,sizeof(struct BinaryLog));
+    if (log == NULL)
+        return NULL;
+    log->file = fopen(PRIVATE_BINARY_LOG_PATH,"ab");
+    if (log->file == NULL) {
+        free(log);
+        return NULL;
+    }
+    /* Unbuffered, so that each chunk goes out in one append */
+    setvbuf(log->file,NULL,_IONBF,0);
+    log->model_name = model_name;
+    log->instance_name = (instance_name != NULL) ? instance_name : "";
+    log->instance = instance;
+    log->open_ticks = fmu_ticks();
+    log->open_ns = fmu_now_ns();
+    binary_log_begin_chunk(log);
+    return log;
+}
+
+static FMU_INLINE void binary_log_close(struct BinaryLog* log)
+{
+    if (log == NULL)
+        return;
+    binary_log_flush(log);
+    fclose(log->file);
+    free(log);
+}
+
+static FMU_INLINE void binary_log_vrecord(struct BinaryLog* log, unsigned int category, const char* format, va_list ap)
+{
+    BinaryLogFormat local;
+    const BinaryLogFormat* signature;
+    fmi3Byte *out, *limit;
+    fmi3UInt64 id = (fmi3UInt64)(size_t)format, ticks;
+    size_t slot = (size_t)((id >> 3) % BINARY_LOG_FORMAT_SLOTS);
+    fmi3UInt8 i, header[2];
+
+    if (log == NULL)
+        return;
+    ticks = fmu_ticks();
+    if (log->used + BINARY_LOG_RECORD_RESERVE > BINARY_LOG_BUFFER_SIZE)
+        binary_log_flush(log);
+    out = log->buffer + log->used;
+
+    /* Define the format on first use, if its slot is taken on every use */
+    signature = &log->formats[slot];
+    if (signature->format != format) {
+        fmi3UInt8 type = BINARY_LOG_RECORD_FORMAT;
+        BinaryLogFormat* target = (signature->format == NULL) ? &log->formats[slot] : &local;
+        if (!binary_log_signature(format,target)) {
+            target->format = NULL;
+            return;
+        }
+        signature = target;
+        out = binary_log_put(out,&type,sizeof(type));
+        out = binary_log_put(out,&id,sizeof(id));
+        out = binary_log_put_string(out,format,BINARY_LOG_MAX_STRING);
+    }
+
+    header[0] = BINARY_LOG_RECORD_MESSAGE;
+    header[1] = (fmi3UInt8)category;
+    limit = out + BINARY_LOG_MAX_RECORD;
+    out = binary_log_put(out,header,sizeof(header));
+    out = binary_log_put(out,&ticks,sizeof(ticks));
+    out = binary_log_put(out,&id,sizeof(id));
+
+    for (i = 0; i<signature->count; i++) {
+        fmi3Int64 value;
+        switch (signature->types[i]) {
+            case BINARY_LOG_VA_INT: value = va_arg(ap,int); break;
+            case BINARY_LOG_VA_LONG: value = va_arg(ap,long); break;
+            case BINARY_LOG_VA_LLONG: value = va_arg(ap,long long); break;
+            case BINARY_LOG_VA_UINT: value = va_arg(ap,unsigned int); break;
+            case BINARY_LOG_VA_ULONG: value = (fmi3Int64)va_arg(ap,unsigned long); break;
+            case BINARY_LOG_VA_ULLONG: value = (fmi3Int64)va_arg(ap,unsigned long long); break;
+            case BINARY_LOG_VA_SIZE: value = (fmi3Int64)va_arg(ap,size_t); break;
+            case BINARY_LOG_VA_INTMAX: value = (fmi3Int64)va_arg(ap,intmax_t); break;
+            case BINARY_LOG_VA_UINTMAX: value = (fmi3Int64)va_arg(ap,uintmax_t); break;
+            case BINARY_LOG_VA_PTRDIFF: value = (fmi3Int64)va_arg(ap,ptrdiff_t); break;
+            case BINARY_LOG_VA_POINTER: value = (fmi3Int64)(size_t)va_arg(ap,void*); break;
+            case BINARY_LOG_VA_DOUBLE:
+            case BINARY_LOG_VA_LDOUBLE: {
+                fmi3Float64 real = (signature->types[i] == BINARY_LOG_VA_LDOUBLE) ?
+                    (fmi3Float64)va_arg(ap,long double) : va_arg(ap,double);
+                out = binary_log_put(out,&real,sizeof(real));
+                continue;
+            }
+            default: {
+                const char* string = va_arg(ap,const char*);
+                size_t room = (out+2 < limit) ? (size_t)(limit - out - 2) : 0;
+                out = binary_log_put_string(out,(string != NULL) ? string : "(null)",
+                    (room < BINARY_LOG_MAX_STRING) ? room : BINARY_LOG_MAX_STRING);
+                continue;
+            }
+        }
+        out = binary_log_put(out,&value,sizeof(value));
+    }
+
+    log->used = (size_t)(out - log->buffer);
+}
+
+#endif
+
+#endif /* BINARY_LOG_H */
@@ -19,6 +19,581 @@
 
 #define safe_strdup(s,default) ((s) ? strdup(s) : (default))
 
+/*
+ * Aligned Allocation
+ *
+ * Large numeric arrays are allocated on cache line boundaries (which
+ * also satisfies the alignment of all SIMD register widths up to
+ * AVX-512), with sizes rounded up to whole cache lines.  Memory
+ * obtained via myalignedcalloc/myalignedrecalloc must be released
+ * with myalignedfree.  Like _recalloc, myalignedrecalloc preserves
+ * the old contents and zeroes any newly added elements.
+ */
+#define FMU_CACHE_LINE_SIZE 64
+
+#ifdef _MSC_VER
+#define FMU_INLINE __inline
+#else
+#define FMU_INLINE inline
+#endif
+
+static FMU_INLINE void* myalignedcalloc(size_t num, size_t size)
+{
+    size_t bytes;
+    void* ptr;
+    /* Like calloc, fail rather than wrap around on overflow */
+    if (size != 0 && num > (((size_t)-1) - FMU_CACHE_LINE_SIZE)/size)
+        return NULL;
+    bytes = (num*size + FMU_CACHE_LINE_SIZE - 1) & ~(size_t)(FMU_CACHE_LINE_SIZE - 1);
+    if (bytes == 0)
+        bytes = FMU_CACHE_LINE_SIZE;
+#ifdef _MSC_VER
+    ptr = _aligned_malloc(bytes,FMU_CACHE_LINE_SIZE);
+#else
+    if (posix_memalign(&ptr,FMU_CACHE_LINE_SIZE,bytes) != 0)
+        ptr = NULL;
+#endif
+    if (ptr != NULL)
+        memset(ptr,0,bytes);
+    return ptr;
+}
+
+static FMU_INLINE void myalignedfree(void* ptr)
+{
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static FMU_INLINE void* myalignedrecalloc(void* ptr, size_t oldnum, size_t num, size_t size)
+{
+    void* result = myalignedcalloc(num,size);
+    if (result != NULL && ptr != NULL) {
+        memcpy(result,ptr,((oldnum < num) ? oldnum : num)*size);
+        myalignedfree(ptr);
+    }
+    return result;
+}
+
+/*
+ * Buffer Reuse
+ *
+ * copy_string_reuse and copy_binary_reuse copy a value into a buffer
+ * whose capacity is tracked by the caller, reallocating only if the
+ * value does not fit.  A NULL string is stored as the empty string;
+ * copy_chars_reuse stores length characters plus a terminating NUL,
+ * concat_strings_reuse the concatenation of two strings, which must
+ * not point into the buffer.  reserve_binary_reuse only makes room for
+ * size bytes, leaving the contents undefined, so that large buffers
+ * are not copied when they grow.  All return 0 on allocation failure,
+ * leaving the buffer untouched.
+ */
+static FMU_INLINE int copy_chars_reuse(char** buffer, size_t* capacity, const char* value, size_t length)
+{
+    if (*buffer == NULL || *capacity < length+1) {
+        char* resized = realloc(*buffer,length+1);
+        if (resized == NULL)
+            return 0;
+        *buffer = resized;
+        *capacity = length+1;
+    }
+    if (length > 0)
+        memcpy(*buffer,value,length);
+    (*buffer)[length] = '\0';
+    return 1;
+}
+
+static FMU_INLINE int copy_string_reuse(char** buffer, size_t* capacity, const char* value)
+{
+    return copy_chars_reuse(buffer,capacity,value,(value != NULL) ? strlen(value) : 0);
+}
+
+static FMU_INLINE int concat_strings_reuse(char** buffer, size_t* capacity, const char* first, const char* second)
+{
+    size_t first_length = strlen(first), second_length = strlen(second);
+    if (*buffer == NULL || *capacity < first_length+second_length+1) {
+        char* resized = realloc(*buffer,first_length+second_length+1);
+        if (resized == NULL)
+            return 0;
+        *buffer = resized;
+        *capacity = first_length+second_length+1;
+    }
+    memcpy(*buffer,first,first_length);
+    memcpy(*buffer+first_length,second,second_length+1);
+    return 1;
+}
+
+static FMU_INLINE int reserve_binary_reuse(fmi3Byte** buffer, size_t* capacity, size_t size)
+{
+    if (size > 0 && (*buffer == NULL || *capacity < size)) {
+        fmi3Byte* resized = malloc(size);
+        if (resized == NULL)
+            return 0;
+        free(*buffer);
+        *buffer = resized;
+        *capacity = size;
+    }
+    return 1;
+}
+
+static FMU_INLINE int copy_binary_reuse(fmi3Byte** buffer, size_t* capacity, const fmi3Byte* value, size_t size)
+{
+    if (size == 0)
+        return 1;
+    if (!reserve_binary_reuse(buffer,capacity,size))
+        return 0;
+    memcpy(*buffer,value,size);
+    return 1;
+}
+
+/*
+ * Log Categories
+ *
+ * The log categories declared in the model descriptions are resolved
+ * into a bitmask once in fmi3SetDebugLogging, so that deciding whether
+ * a message is wanted is a single AND on the logging path.  Unknown
+ * category names resolve to no bits.
+ */
+#define LOG_CATEGORY_FMI (1u << 0)
+#define LOG_CATEGORY_BINARY (1u << 1)
+#define LOG_CATEGORY_PERF (1u << 2)
+#define LOG_CATEGORIES_ALL (LOG_CATEGORY_FMI | LOG_CATEGORY_BINARY | LOG_CATEGORY_PERF)
+
+static FMU_INLINE unsigned int log_category_mask(const char* name)
+{
+    if (name == NULL)
+        return 0;
+    if (0==strcmp(name,"FMI"))
+        return LOG_CATEGORY_FMI;
+    if (0==strcmp(name,"BINARY"))
+        return LOG_CATEGORY_BINARY;
+    if (0==strcmp(name,"PERF"))
+        return LOG_CATEGORY_PERF;
+    return 0;
+}
+
+static FMU_INLINE const char* log_category_name(unsigned int category)
+{
+    switch (category) {
+        case LOG_CATEGORY_BINARY:
+            return "BINARY";
+        case LOG_CATEGORY_PERF:
+            return "PERF";
+        default:
+            return "FMI";
+    }
+}
+
+/*
+ * FMU State Serialization
+ *
+ * Serialized FMU states are little-endian byte streams starting with
+ * a header of the magic "PMSF", a uint16 format version, a uint16 of
+ * reserved zero bits and the instantiation token (uint64 length plus
+ * characters), so that states are only accepted by the same FMU build.
+ * Sections of fixed-width values are written with put_values and read
+ * with get_values, which boil down to a single memcpy per section on
+ * little-endian hosts.  The reader tracks the remaining input and
+ * fails (ok = 0) instead of reading past its end.
+ */
+#define FMU_STATE_MAGIC "PMSF"
+#define FMU_STATE_FORMAT_VERSION 1
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define FMU_BIG_ENDIAN
+#endif
+
+/* Booleans are serialized as single bytes */
+typedef char fmu_boolean_size_check[(sizeof(fmi3Boolean) == 1) ? 1 : -1];
+
+typedef struct {
+    const fmi3Byte* pos;
+    const fmi3Byte* end;
+    int ok;
+} FMUStateReader;
+
+static FMU_INLINE fmi3Byte* put_values(fmi3Byte* out, const void* values, size_t count, size_t width)
+{
+#ifdef FMU_BIG_ENDIAN
+    const fmi3Byte* in = (const fmi3Byte*)values;
+    size_t i, j;
+    for (i = 0; i<count; i++, in += width)
+        for (j = 0; j<width; j++)
+            *out++ = in[width-1-j];
+    return out;
+#else
+    if (count > 0)
+        memcpy(out,values,count*width);
+    return out+count*width;
+#endif
+}
+
+static FMU_INLINE fmi3Byte* put_uint64(fmi3Byte* out, fmi3UInt64 value)
+{
+    return put_values(out,&value,1,sizeof(value));
+}
+
+static FMU_INLINE void get_values(FMUStateReader* reader, void* values, size_t count, size_t width)
+{
+    if (!reader->ok || count > (size_t)(reader->end - reader->pos) / width) {
+        reader->ok = 0;
+        return;
+    }
+#ifdef FMU_BIG_ENDIAN
+    {
+        fmi3Byte* out = (fmi3Byte*)values;
+        size_t i, j;
+        for (i = 0; i<count; i++, out += width)
+            for (j = 0; j<width; j++)
+                out[j] = reader->pos[i*width+width-1-j];
+    }
+#else
+    if (count > 0)
+        memcpy(values,reader->pos,count*width);
+#endif
+    reader->pos += count*width;
+}
+
+static FMU_INLINE fmi3UInt64 get_uint64(FMUStateReader* reader)
+{
+    fmi3UInt64 value = 0;
+    get_values(reader,&value,1,sizeof(value));
+    return value;
+}
+
+/* Boolean bytes must be 0 or 1 before they may be read as fmi3Boolean */
+static FMU_INLINE void get_booleans(FMUStateReader* reader, fmi3Boolean* values, size_t count)
+{
+    size_t i;
+    if (reader->ok && count <= (size_t)(reader->end - reader->pos))
+        for (i = 0; i<count; i++)
+            if (reader->pos[i] > 1)
+                reader->ok = 0;
+    get_values(reader,values,count,1);
+}
+
+/* Raw view of the next length bytes (length-prefixed strings/binaries) */
+static FMU_INLINE const fmi3Byte* get_bytes(FMUStateReader* reader, size_t* length)
+{
+    const fmi3Byte* bytes;
+    fmi3UInt64 size = get_uint64(reader);
+    if (!reader->ok || size > (fmi3UInt64)(reader->end - reader->pos)) {
+        reader->ok = 0;
+        *length = 0;
+        return NULL;
+    }
+    bytes = reader->pos;
+    reader->pos += (size_t)size;
+    *length = (size_t)size;
+    return bytes;
+}
+
+static FMU_INLINE size_t state_header_size(const char* token)
+{
+    return 4 + 2 + 2 + 8 + strlen(token);
+}
+
+static FMU_INLINE fmi3Byte* put_state_header(fmi3Byte* out, const char* token)
+{
+    fmi3UInt16 version = FMU_STATE_FORMAT_VERSION, reserved = 0;
+    size_t length = strlen(token);
+    memcpy(out,FMU_STATE_MAGIC,4);
+    out = put_values(out+4,&version,1,sizeof(version));
+    out = put_values(out,&reserved,1,sizeof(reserved));
+    out = put_uint64(out,length);
+    memcpy(out,token,length);
+    return out+length;
+}
+
+static FMU_INLINE void get_state_header(FMUStateReader* reader, const char* token)
+{
+    fmi3UInt16 version = 0, reserved = 0;
+    const fmi3Byte* bytes;
+    size_t length;
+    if (!reader->ok || reader->end - reader->pos < 4 || 0 != memcmp(reader->pos,FMU_STATE_MAGIC,4)) {
+        reader->ok = 0;
+        return;
+    }
+    reader->pos += 4;
+    get_values(reader,&version,1,sizeof(version));
+    get_values(reader,&reserved,1,sizeof(reserved));
+    bytes = get_bytes(reader,&length);
+    if (version != FMU_STATE_FORMAT_VERSION || reserved != 0 ||
+        length != strlen(token) || (length > 0 && 0 != memcmp(bytes,token,length)))
+        reader->ok = 0;
+}
+
+/*
+ * SIMD Support
+ *
+ * FMU_SIMD_X86 is defined if x86 SIMD intrinsics are available.
+ * Kernels using instruction set extensions beyond the compiler's
+ * baseline must be marked with FMU_TARGET("isa") and may only be
+ * called after the matching fmu_cpu_has_*() runtime check succeeded.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FMU_SIMD_X86
+#include <immintrin.h>
+#define FMU_TARGET(isa) __attribute__((target(isa)))
+#define fmu_cpu_init() __builtin_cpu_init()
+#define fmu_cpu_has_sse2() __builtin_cpu_supports("sse2")
+#define fmu_cpu_has_avx() __builtin_cpu_supports("avx")
+#define fmu_cpu_has_avx2() __builtin_cpu_supports("avx2")
+#define fmu_cpu_has_avx512f() __builtin_cpu_supports("avx512f")
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define FMU_SIMD_X86
+#include <intrin.h>
+#include <immintrin.h>
+#define FMU_TARGET(isa)
+#define fmu_cpu_init()
+#define FMU_CPU_SSE2    0x01
+#define FMU_CPU_AVX     0x02
+#define FMU_CPU_AVX2    0x04
+#define FMU_CPU_AVX512F 0x08
+static FMU_INLINE int fmu_cpu_features(void)
+{
+    int info[4], features = 0;
+    unsigned long long xcr0 = 0;
+    __cpuid(info,0);
+    if (info[0] < 1)
+        return 0;
+    __cpuid(info,1);
+    if (info[3] & (1<<26)) features |= FMU_CPU_SSE2;
+    /* AVX state must be enabled by the OS (OSXSAVE + XCR0) */
+    if ((info[2] & (1<<27)) && (info[2] & (1<<28))) {
+        xcr0 = _xgetbv(0);
+        if ((xcr0 & 0x06) == 0x06) features |= FMU_CPU_AVX;
+    }
+    __cpuidex(info,7,0);
+    if ((features & FMU_CPU_AVX) && (info[1] & (1<<5))) features |= FMU_CPU_AVX2;
+    if ((features & FMU_CPU_AVX) && (info[1] & (1<<16)) && (xcr0 & 0xE6) == 0xE6) features |= FMU_CPU_AVX512F;
+    return features;
+}
+#define fmu_cpu_has_sse2() (fmu_cpu_features() & FMU_CPU_SSE2)
+#define fmu_cpu_has_avx() (fmu_cpu_features() & FMU_CPU_AVX)
+#define fmu_cpu_has_avx2() (fmu_cpu_features() & FMU_CPU_AVX2)
+#define fmu_cpu_has_avx512f() (fmu_cpu_features() & FMU_CPU_AVX512F)
+#endif
+
+/*
+ * Timing
+ *
+ * fmu_now_ns reads a monotonic clock in nanoseconds.  fmu_ticks is a
+ * cheaper tick counter (the TSC on x86, else the same clock) for
+ * timing short intervals; ticks are converted to nanoseconds with the
+ * rate measured between two (ticks, ns) pairs.
+ */
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(FMU_SIMD_X86) && !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+
+static FMU_INLINE fmi3UInt64 fmu_now_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (fmi3UInt64)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (fmi3UInt64)ts.tv_sec * 1000000000u + (fmi3UInt64)ts.tv_nsec;
+#endif
+}
+
+static FMU_INLINE fmi3UInt64 fmu_ticks(void)
+{
+#ifdef FMU_SIMD_X86
+    return (fmi3UInt64)__rdtsc();
+#else
+    return fmu_now_ns();
+#endif
+}
+
+/*
+ * Performance Counters
+ *
+ * While the PERF log category is enabled, each instance counts the
+ * calls of the instrumented API functions and sorts their durations
+ * into histogram buckets of powers of two ticks.  Calls returning
+ * early on invalid arguments are not timed (see the error counters
+ * instead).  perf_begin returns 0 while counting is off, which
+ * perf_end takes as the signal to do nothing, so the counters cost a
+ * load and a branch per call when not in use.  The counters survive
+ * switching PERF off and on and are reported by perf_format.
+ */
+typedef enum {
+    PERF_DO_STEP,
+    PERF_GET_FLOAT32,
+    PERF_GET_FLOAT64,
+    PERF_GET_INT8,
+    PERF_GET_UINT8,
+    PERF_GET_INT16,
+    PERF_GET_UINT16,
+    PERF_GET_INT32,
+    PERF_GET_UINT32,
+    PERF_GET_INT64,
+    PERF_GET_UINT64,
+    PERF_GET_BOOLEAN,
+    PERF_GET_STRING,
+    PERF_GET_BINARY,
+    PERF_SET_FLOAT32,
+    PERF_SET_FLOAT64,
+    PERF_SET_INT8,
+    PERF_SET_UINT8,
+    PERF_SET_INT16,
+    PERF_SET_UINT16,
+    PERF_SET_INT32,
+    PERF_SET_UINT32,
+    PERF_SET_INT64,
+    PERF_SET_UINT64,
+    PERF_SET_BOOLEAN,
+    PERF_SET_STRING,
+    PERF_SET_BINARY,
+    PERF_DO_INIT_CALC,
+    PERF_ENTER_CONFIGURATION_MODE,
+    PERF_EXIT_CONFIGURATION_MODE,
+    PERF_GET_PREPARED,
+    PERF_SET_PREPARED,
+    PERF_FUNCTIONS
+} PerfFunction;
+
+static const char* const perf_function_names[PERF_FUNCTIONS] = {
+    "fmi3DoStep",
+    "fmi3GetFloat32", "fmi3GetFloat64", "fmi3GetInt8", "fmi3GetUInt8", "fmi3GetInt16", "fmi3GetUInt16",
+    "fmi3GetInt32", "fmi3GetUInt32", "fmi3GetInt64", "fmi3GetUInt64", "fmi3GetBoolean", "fmi3GetString", "fmi3GetBinary",
+    "fmi3SetFloat32", "fmi3SetFloat64", "fmi3SetInt8", "fmi3SetUInt8", "fmi3SetInt16", "fmi3SetUInt16",
+    "fmi3SetInt32", "fmi3SetUInt32", "fmi3SetInt64", "fmi3SetUInt64", "fmi3SetBoolean", "fmi3SetString", "fmi3SetBinary",
+    "doInitCalc",
+    "fmi3EnterConfigurationMode",
+    "fmi3ExitConfigurationMode",
+    "fmi3xGetPrepared", "fmi3xSetPrepared"
+};
+
+/* Bucket b holds durations of [2^b,2^(b+1)) ticks, bucket 0 also 0 ticks */
+#define PERF_BUCKETS 64
+#define perf_bucket_limit(bucket) (2.0 * (double)((fmi3UInt64)1 << (bucket)))
+
+typedef struct {
+    fmi3UInt64 calls;
+    fmi3UInt64 ticks;
+    fmi3UInt64 buckets[PERF_BUCKETS];
+} PerfCounter;
+
+struct PerfCounters {
+    int active;
+    fmi3UInt64 start_ticks;
+    fmi3UInt64 start_ns;
+    PerfCounter counters[PERF_FUNCTIONS];
+};
+
+/* Allocates the counters on first activation, returns 0 if that fails */
+static FMU_INLINE int perf_activate(struct PerfCounters** perf, int active)
+{
+    if (*perf == NULL) {
+        if (!active)
+            return 1;
+        *perf = calloc(1,sizeof(struct PerfCounters));
+        if (*perf == NULL)
+            return 0;
+        (*perf)->start_ticks = fmu_ticks();
+        (*perf)->start_ns = fmu_now_ns();
+    }
+    (*perf)->active = active;
+    return 1;
+}
+
+static FMU_INLINE fmi3UInt64 perf_begin(const struct PerfCounters* perf)
+{
+    /* Never 0 when counting, at the cost of the lowest tick bit */
+    return (perf != NULL && perf->active) ? fmu_ticks() | 1u : 0;
+}
+
+static FMU_INLINE unsigned int perf_bucket(fmi3UInt64 ticks)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return ticks ? 63 - (unsigned int)__builtin_clzll(ticks) : 0;
+#else
+    unsigned int bucket = 0;
+    while (ticks >>= 1)
+        bucket++;
+    return bucket;
+#endif
+}
+
+static FMU_INLINE fmi3Status perf_end(struct PerfCounters* perf, PerfFunction function, fmi3UInt64 start, fmi3Status status)
+{
+    if (start != 0) {
+        PerfCounter* counter = &perf->counters[function];
+        fmi3UInt64 ticks = fmu_ticks() - start;
+        if ((fmi3Int64)ticks < 0)
+            ticks = 0;
+        counter->calls++;
+        counter->ticks += ticks;
+        counter->buckets[perf_bucket(ticks)]++;
+    }
+    return status;
+}
+
+/* Upper bound of the bucket below which the given fraction of calls lies */
+static FMU_INLINE double perf_percentile(const PerfCounter* counter, double fraction, double ns_per_tick)
+{
+    fmi3UInt64 seen = 0, target = (fmi3UInt64)((double)counter->calls * fraction);
+    unsigned int bucket;
+    for (bucket = 0; bucket<PERF_BUCKETS-1; bucket++) {
+        seen += counter->buckets[bucket];
+        if (seen > target)
+            break;
+    }
+    return perf_bucket_limit(bucket) * ns_per_tick;
+}
+
+/*
+ * Render the counters of one function as a line of text, with the
+ * histogram as the number of calls below each bucket's upper bound in
+ * nanoseconds; returns 0 if the function was not called.
+ */
+static FMU_INLINE int perf_format(const struct PerfCounters* perf, PerfFunction function, char* buffer, size_t size)
+{
+    const PerfCounter* counter;
+    fmi3UInt64 ticks, ns;
+    double ns_per_tick = 1.0;
+    size_t used;
+    unsigned int bucket;
+    int length;
+
+    if (perf == NULL || perf->counters[function].calls == 0)
+        return 0;
+    counter = &perf->counters[function];
+    ticks = fmu_ticks();
+    ns = fmu_now_ns();
+    if (ticks > perf->start_ticks && ns > perf->start_ns)
+        ns_per_tick = (double)(ns - perf->start_ns) / (double)(ticks - perf->start_ticks);
+
+    length = snprintf(buffer,size,"%s: %llu calls, %.0f ns total, %.1f ns mean, p50 < %.0f ns, p99 < %.0f ns, histogram",
+        perf_function_names[function],(unsigned long long)counter->calls,
+        (double)counter->ticks*ns_per_tick,(double)counter->ticks*ns_per_tick/(double)counter->calls,
+        perf_percentile(counter,0.5,ns_per_tick),perf_percentile(counter,0.99,ns_per_tick));
+    for (bucket = 0; bucket<PERF_BUCKETS && length >= 0 && (size_t)length < size; bucket++) {
+        if (counter->buckets[bucket] == 0)
+            continue;
+        used = (size_t)length;
+        length += snprintf(buffer+used,size-used," <%.0f:%llu",
+            perf_bucket_limit(bucket)*ns_per_tick,(unsigned long long)counter->buckets[bucket]);
+    }
+    return 1;
+}
+
 /*
  * Debug Breaks
  *
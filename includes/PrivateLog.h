@@ -0,0 +1,262 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef PRIVATE_LOG_H
+#define PRIVATE_LOG_H
+
+/*
+ * Private File-based Logging just for Debugging
+ *
+ * Lines for the file at PRIVATE_LOG_PATH are written with
+ * private_log_printf/private_log_vprintf, which by default write and
+ * flush each line synchronously.
+ *
+ * With PRIVATE_LOG_ASYNC, while at least one instance is attached via
+ * private_log_attach/private_log_detach, lines are instead formatted
+ * into a ring of PRIVATE_LOG_RING_SLOTS fixed-size slots, which a
+ * background thread writes out every PRIVATE_LOG_FLUSH_INTERVAL
+ * milliseconds.  The ring is a bounded lock-free multi-producer queue
+ * with a sequence number per slot, so logging threads never block:
+ * lines that find the ring full are dropped and their number is
+ * reported in the log, and lines longer than PRIVATE_LOG_LINE_SIZE
+ * are truncated.  The last detach waits for producers still writing
+ * into the ring, drains it and stops the thread, so it must happen
+ * before the shared object is unloaded.
+ *
+ * Requires CommonUtil.h to be included beforehand.
+ */
+#ifdef PRIVATE_LOG_PATH
+
+#define PRIVATE_LOG_LINE_SIZE 1280
+
+static FILE* private_log_file = NULL;
+
+static FMU_INLINE int private_log_open(void)
+{
+    if (private_log_file == NULL)
+        private_log_file = fopen(PRIVATE_LOG_PATH,"a");
+    return private_log_file != NULL;
+}
+
+#ifdef PRIVATE_LOG_ASYNC
+#include "ThreadUtil.h"
+
+#ifndef PRIVATE_LOG_RING_SLOTS
+#define PRIVATE_LOG_RING_SLOTS 1024
+#endif
+#ifndef PRIVATE_LOG_FLUSH_INTERVAL
+#define PRIVATE_LOG_FLUSH_INTERVAL 10
+#endif
+
+/* The ring is indexed by masking, so its size must be a power of two */
+typedef char private_log_ring_slots_check[((PRIVATE_LOG_RING_SLOTS & (PRIVATE_LOG_RING_SLOTS-1)) == 0) ? 1 : -1];
+
+/*
+ * A slot at ring position p is free for the producer claiming p when
+ * its sequence is p, and holds a complete line for the consumer when
+ * its sequence is p+1.  The consumer hands it on to position
+ * p+PRIVATE_LOG_RING_SLOTS after writing it out.
+ */
+typedef struct {
+    fmu_atomic sequence;
+    char line[PRIVATE_LOG_LINE_SIZE];
+} PrivateLogSlot;
+
+static struct {
+    PrivateLogSlot* slots;
+    fmu_atomic head;
+    fmu_atomic dropped;
+    fmu_atomic running;
+    /* Producers between checking running and publishing their line */
+    fmu_atomic producers;
+    fmu_atomic stop;
+    fmu_atomic lock;
+    long long tail;
+    long long reported;
+    size_t users;
+    fmu_thread flusher;
+} private_log;
+
+static FMU_INLINE int private_log_enqueue(const char* prefix, const char* format, va_list ap)
+{
+    PrivateLogSlot* slot;
+    long long position, sequence;
+    size_t length = 0;
+
+    /* Announce the producer first, so that detach waits for it */
+    fmu_atomic_add(&private_log.producers,1);
+    if (!fmu_atomic_load(&private_log.running)) {
+        fmu_atomic_add(&private_log.producers,-1);
+        return 0;
+    }
+
+    position = fmu_atomic_load(&private_log.head);
+    for (;;) {
+        slot = &private_log.slots[position & (PRIVATE_LOG_RING_SLOTS-1)];
+        sequence = fmu_atomic_load(&slot->sequence);
+        if (sequence == position) {
+            if (fmu_atomic_cas(&private_log.head,position,position+1))
+                break;
+            position = fmu_atomic_load(&private_log.head);
+        } else if (sequence < position) {
+            fmu_atomic_add(&private_log.dropped,1);
+            fmu_atomic_add(&private_log.producers,-1);
+            return 1;
+        } else {
+            position = fmu_atomic_load(&private_log.head);
+        }
+    }
+
+    if (prefix != NULL) {
+        length = strlen(prefix);
+        if (length >= PRIVATE_LOG_LINE_SIZE)
+            length = PRIVATE_LOG_LINE_SIZE-1;
+        memcpy(slot->line,prefix,length);
+    }
+#ifdef _WIN32
+    vsnprintf_s(slot->line+length, PRIVATE_LOG_LINE_SIZE-length, _TRUNCATE, format, ap);
+#else
+    vsnprintf(slot->line+length, PRIVATE_LOG_LINE_SIZE-length, format, ap);
+#endif
+    slot->line[PRIVATE_LOG_LINE_SIZE-1] = '\0';
+    fmu_atomic_store(&slot->sequence,position+1);
+    fmu_atomic_add(&private_log.producers,-1);
+    return 1;
+}
+
+/* Write out all complete lines, only ever called by one thread at a time */
+static void private_log_drain(void)
+{
+    long long dropped;
+    int written = 0;
+    for (;;) {
+        PrivateLogSlot* slot = &private_log.slots[private_log.tail & (PRIVATE_LOG_RING_SLOTS-1)];
+        if (fmu_atomic_load(&slot->sequence) != private_log.tail+1)
+            break;
+        fputs(slot->line,private_log_file);
+        fputc('\n',private_log_file);
+        fmu_atomic_store(&slot->sequence,private_log.tail+PRIVATE_LOG_RING_SLOTS);
+        private_log.tail++;
+        written = 1;
+    }
+    dropped = fmu_atomic_load(&private_log.dropped);
+    if (dropped != private_log.reported) {
+        fprintf(private_log_file,"%s::Global: %lld log lines dropped (ring buffer full)\n",FMU_MODEL_NAME,dropped-private_log.reported);
+        private_log.reported = dropped;
+        written = 1;
+    }
+    if (written)
+        fflush(private_log_file);
+}
+
+FMU_THREAD_FUNCTION(private_log_flusher,arg)
+{
+    long long stop;
+    (void)arg;
+    do {
+        stop = fmu_atomic_load(&private_log.stop);
+        private_log_drain();
+        if (!stop)
+            fmu_sleep_ms(PRIVATE_LOG_FLUSH_INTERVAL);
+    } while (!stop);
+    FMU_THREAD_RETURN;
+}
+
+static FMU_INLINE void private_log_lock(void)
+{
+    while (!fmu_atomic_cas(&private_log.lock,0,1))
+        fmu_thread_yield();
+}
+
+static FMU_INLINE void private_log_unlock(void)
+{
+    fmu_atomic_store(&private_log.lock,0);
+}
+
+/* Start the writer thread with the first attached instance */
+static FMU_INLINE void private_log_attach(void)
+{
+    private_log_lock();
+    if (private_log.users++ == 0 && private_log_open()) {
+        private_log.slots = calloc(PRIVATE_LOG_RING_SLOTS,sizeof(PrivateLogSlot));
+        if (private_log.slots != NULL) {
+            long long i;
+            for (i = 0; i<PRIVATE_LOG_RING_SLOTS; i++)
+                fmu_atomic_store(&private_log.slots[i].sequence,i);
+            fmu_atomic_store(&private_log.head,0);
+            fmu_atomic_store(&private_log.dropped,0);
+            fmu_atomic_store(&private_log.stop,0);
+            private_log.tail = 0;
+            private_log.reported = 0;
+            if (fmu_thread_create(&private_log.flusher,private_log_flusher,NULL)) {
+                fmu_atomic_store(&private_log.running,1);
+            } else {
+                free(private_log.slots);
+                private_log.slots = NULL;
+            }
+        }
+    }
+    private_log_unlock();
+}
+
+/*
+ * Drain the ring and stop the writer thread with the last detached
+ * instance.  Clearing running with a full barrier and then waiting for
+ * the producers that got past it means all claimed slots are published
+ * before the final drain, and none are written after the ring is freed.
+ */
+static FMU_INLINE void private_log_detach(void)
+{
+    private_log_lock();
+    if (private_log.users > 0 && --private_log.users == 0 && private_log.slots != NULL) {
+        fmu_atomic_cas(&private_log.running,1,0);
+        while (fmu_atomic_load(&private_log.producers) != 0)
+            fmu_thread_yield();
+        fmu_atomic_store(&private_log.stop,1);
+        fmu_thread_join(private_log.flusher);
+        free(private_log.slots);
+        private_log.slots = NULL;
+    }
+    private_log_unlock();
+}
+#else
+#define private_log_attach() ((void)0)
+#define private_log_detach() ((void)0)
+#endif
+
+static FMU_INLINE void private_log_vprintf(const char* prefix, const char* format, va_list ap)
+{
+#ifdef PRIVATE_LOG_ASYNC
+    if (private_log_enqueue(prefix,format,ap))
+        return;
+#endif
+    if (!private_log_open())
+        return;
+    if (prefix != NULL)
+        fputs(prefix,private_log_file);
+    vfprintf(private_log_file,format,ap);
+    fputc('\n',private_log_file);
+    fflush(private_log_file);
+}
+
+static FMU_INLINE void private_log_printf(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    private_log_vprintf(NULL,format,ap);
+    va_end(ap);
+}
+
+#else
+#define private_log_attach() ((void)0)
+#define private_log_detach() ((void)0)
+#endif
+
+#endif /* PRIVATE_LOG_H */
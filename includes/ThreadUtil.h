@@ -0,0 +1,100 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef THREAD_UTIL_H
+#define THREAD_UTIL_H
+
+/*
+ * Minimal Threading Support
+ *
+ * Thin macro layer over Win32 threads and POSIX threads, covering
+ * just what the FMUs need: threads, mutexes, condition variables,
+ * sleeping/yielding, thread and process ids, thread-local storage and
+ * a few atomic operations on 64-bit integers.  Thread functions are
+ * declared via FMU_THREAD_FUNCTION(name,arg) and must end with
+ * FMU_THREAD_RETURN.  fmu_thread_create returns non-zero on success.
+ *
+ * Atomic loads have acquire, stores release semantics; fmu_atomic_cas
+ * (returning non-zero on success) and fmu_atomic_add (returning the
+ * previous value) are full barriers.
+ */
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE fmu_thread;
+typedef CRITICAL_SECTION fmu_mutex;
+typedef CONDITION_VARIABLE fmu_cond;
+#define FMU_THREAD_FUNCTION(name,arg) static DWORD WINAPI name(LPVOID arg)
+#define FMU_THREAD_RETURN return 0
+#define fmu_thread_create(t,fn,arg) ((*(t) = CreateThread(NULL,0,fn,arg,0,NULL)) != NULL)
+#define fmu_thread_join(t) (WaitForSingleObject(t,INFINITE), CloseHandle(t))
+#define fmu_mutex_init(m) InitializeCriticalSection(m)
+#define fmu_mutex_destroy(m) DeleteCriticalSection(m)
+#define fmu_mutex_lock(m) EnterCriticalSection(m)
+#define fmu_mutex_unlock(m) LeaveCriticalSection(m)
+#define fmu_cond_init(c) InitializeConditionVariable(c)
+#define fmu_cond_destroy(c) ((void)(c))
+#define fmu_cond_wait(c,m) SleepConditionVariableCS(c,m,INFINITE)
+#define fmu_cond_signal(c) WakeConditionVariable(c)
+#define fmu_cond_broadcast(c) WakeAllConditionVariable(c)
+#define fmu_thread_yield() SwitchToThread()
+#define fmu_sleep_ms(ms) Sleep(ms)
+typedef volatile LONG64 fmu_atomic;
+#define fmu_atomic_load(p) InterlockedCompareExchange64((p),0,0)
+#define fmu_atomic_store(p,v) ((void)InterlockedExchange64((p),(v)))
+#define fmu_atomic_cas(p,expected,desired) (InterlockedCompareExchange64((p),(desired),(expected)) == (expected))
+#define fmu_atomic_add(p,v) InterlockedExchangeAdd64((p),(v))
+#define fmu_thread_id() ((unsigned long long)GetCurrentThreadId())
+#define fmu_process_id() ((unsigned long long)GetCurrentProcessId())
+#define FMU_THREAD_LOCAL __declspec(thread)
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+typedef pthread_t fmu_thread;
+typedef pthread_mutex_t fmu_mutex;
+typedef pthread_cond_t fmu_cond;
+#define FMU_THREAD_FUNCTION(name,arg) static void* name(void* arg)
+#define FMU_THREAD_RETURN return NULL
+#define fmu_thread_create(t,fn,arg) (pthread_create(t,NULL,fn,arg) == 0)
+#define fmu_thread_join(t) pthread_join(t,NULL)
+#define fmu_mutex_init(m) pthread_mutex_init(m,NULL)
+#define fmu_mutex_destroy(m) pthread_mutex_destroy(m)
+#define fmu_mutex_lock(m) pthread_mutex_lock(m)
+#define fmu_mutex_unlock(m) pthread_mutex_unlock(m)
+#define fmu_cond_init(c) pthread_cond_init(c,NULL)
+#define fmu_cond_destroy(c) pthread_cond_destroy(c)
+#define fmu_cond_wait(c,m) pthread_cond_wait(c,m)
+#define fmu_cond_signal(c) pthread_cond_signal(c)
+#define fmu_cond_broadcast(c) pthread_cond_broadcast(c)
+#define fmu_thread_yield() sched_yield()
+#define fmu_sleep_ms(ms) \
+    do { \
+        struct timespec fmu_sleep_ts_; \
+        fmu_sleep_ts_.tv_sec = (ms)/1000; \
+        fmu_sleep_ts_.tv_nsec = ((ms)%1000)*1000000L; \
+        nanosleep(&fmu_sleep_ts_,NULL); \
+    } while(0)
+typedef long long fmu_atomic;
+#define fmu_atomic_load(p) __atomic_load_n((p),__ATOMIC_ACQUIRE)
+#define fmu_atomic_store(p,v) __atomic_store_n((p),(v),__ATOMIC_RELEASE)
+#define fmu_atomic_cas(p,expected,desired) __sync_bool_compare_and_swap((p),(expected),(desired))
+#define fmu_atomic_add(p,v) __sync_fetch_and_add((p),(v))
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#define fmu_thread_id() ((unsigned long long)syscall(SYS_gettid))
+#else
+#define fmu_thread_id() ((unsigned long long)(size_t)pthread_self())
+#endif
+#define fmu_process_id() ((unsigned long long)getpid())
+#define FMU_THREAD_LOCAL __thread
+#endif
+
+#endif /* THREAD_UTIL_H */
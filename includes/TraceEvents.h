@@ -0,0 +1,322 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+/*
+ * Chrome Trace Events
+ *
+ * With TRACE_EVENTS_PATH defined, every exported FMI function as well
+ * as doCalc and doInitCalc record a begin event on entry (trace_begin)
+ * and an end event on every way out (trace_end, or trace_return
+ * around the returned status, which is evaluated first).  Events carry a timestamp and the
+ * calling thread, begin events also the function and the instance,
+ * which registers its name with trace_attach and unregisters it with
+ * trace_detach.
+ *
+ * The events of all instances of an FMU are collected in a buffer of
+ * TRACE_EVENTS_BUFFER_SIZE events, which is written out whenever it
+ * is full and whenever an instance is detached, in the Chrome JSON
+ * trace event format (for chrome://tracing or ui.perfetto.dev), to the
+ * file TRACE_EVENTS_PATH "-<pid>-" FMU_MODEL_NAME ".json".  Each FMU
+ * has its own file, as the FMUs of a process do not share the buffer
+ * and could not agree on which of them starts the JSON array.  Events
+ * appear on one track per thread, so that calls into different
+ * instances from the same thread show up in sequence.  Events are only
+ * recorded while an instance is attached, and an end event only after
+ * the begin event of its thread, so that e.g. fmi3GetVersion or a
+ * failed instantiation leave no buffer behind.
+ * The file is appended to in whole lines and its JSON array is never
+ * closed, as the format allows, so it stays readable even if the
+ * process does not exit cleanly.
+ *
+ * Requires CommonUtil.h and UsdtProbes.h to be included beforehand.
+ */
+#ifdef TRACE_EVENTS_PATH
+#include "ThreadUtil.h"
+
+#ifndef TRACE_EVENTS_BUFFER_SIZE
+#define TRACE_EVENTS_BUFFER_SIZE 65536
+#endif
+#define TRACE_EVENTS_CHUNK_SIZE 65536
+#define TRACE_EVENTS_LINE_SIZE 1024
+/* Instance names are truncated to this length before escaping */
+#define TRACE_EVENTS_MAX_NAME 128
+
+typedef struct {
+    fmi3UInt64 ticks;
+    fmi3UInt64 thread;
+    const char* name;
+    size_t instance;
+} TraceEvent;
+
+static struct {
+    fmu_atomic lock;
+    TraceEvent* events;
+    size_t used;
+    fmi3UInt64 start_ticks;
+    fmi3UInt64 start_ns;
+    /* JSON-escaped instance names, instance ids are index+1 */
+    char** instances;
+    size_t instance_count;
+    size_t users;
+    FILE* file;
+    size_t chunk_used;
+    char chunk[TRACE_EVENTS_CHUNK_SIZE];
+} trace_events;
+
+static FMU_THREAD_LOCAL fmi3UInt64 trace_thread_id;
+/* Begin events of the thread still waiting for their end event */
+static FMU_THREAD_LOCAL size_t trace_thread_depth;
+
+static FMU_INLINE void trace_lock(void)
+{
+    while (!fmu_atomic_cas(&trace_events.lock,0,1))
+        fmu_thread_yield();
+}
+
+static FMU_INLINE void trace_unlock(void)
+{
+    fmu_atomic_store(&trace_events.lock,0);
+}
+
+static FMU_INLINE void trace_write_chunk(void)
+{
+    if (trace_events.chunk_used > 0)
+        fwrite(trace_events.chunk,1,trace_events.chunk_used,trace_events.file);
+    trace_events.chunk_used = 0;
+}
+
+static FMU_INLINE char* trace_put(char* out, const char* text)
+{
+    size_t length = strlen(text);
+    memcpy(out,text,length);
+    return out+length;
+}
+
+static FMU_INLINE char* trace_put_uint(char* out, fmi3UInt64 value)
+{
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value%10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0)
+        *out++ = digits[--count];
+    return out;
+}
+
+/*
+ * Write out and empty the buffer, with the lock held.  The lines are
+ * put together by hand, as formatting them with snprintf would cost
+ * more than recording the events in the first place.
+ */
+static void trace_write(void)
+{
+    fmi3UInt64 ticks = fmu_ticks(), ns = fmu_now_ns();
+    double ns_per_tick = 1.0;
+    char ids[64], *out;
+    size_t i;
+
+    if (trace_events.used == 0)
+        return;
+    if (trace_events.file == NULL) {
+        char path[1024];
+        snprintf(path,sizeof(path),"%s-%llu-" FMU_MODEL_NAME ".json",TRACE_EVENTS_PATH,fmu_process_id());
+        trace_events.file = fopen(path,"a");
+        if (trace_events.file == NULL) {
+            trace_events.used = 0;
+            return;
+        }
+        /* Unbuffered, so that every chunk of whole lines is one write */
+        setvbuf(trace_events.file,NULL,_IONBF,0);
+        fseek(trace_events.file,0,SEEK_END);
+        if (ftell(trace_events.file) == 0)
+            fputs("[\n",trace_events.file);
+    }
+    if (ticks > trace_events.start_ticks && ns > trace_events.start_ns)
+        ns_per_tick = (double)(ns - trace_events.start_ns) / (double)(ticks - trace_events.start_ticks);
+    out = trace_put(ids,",\"pid\":");
+    out = trace_put_uint(out,fmu_process_id());
+    out = trace_put(out,",\"tid\":");
+    *out = '\0';
+
+    for (i = 0; i<trace_events.used; i++) {
+        const TraceEvent* event = &trace_events.events[i];
+        const char* instance = (event->instance > 0 && event->instance <= trace_events.instance_count) ? trace_events.instances[event->instance-1] : NULL;
+        fmi3UInt64 time = trace_events.start_ns + (fmi3UInt64)((double)(event->ticks - trace_events.start_ticks) * ns_per_tick);
+        if (trace_events.chunk_used + TRACE_EVENTS_LINE_SIZE > TRACE_EVENTS_CHUNK_SIZE)
+            trace_write_chunk();
+        out = trace_events.chunk + trace_events.chunk_used;
+        if (event->name == NULL) {
+            out = trace_put(out,"{\"ph\":\"E\"");
+        } else {
+            out = trace_put(out,"{\"name\":\"");
+            out = trace_put(out,event->name);
+            out = trace_put(out,"\",\"cat\":\"" FMU_MODEL_NAME "\",\"ph\":\"B\"");
+        }
+        /* Timestamps are in microseconds */
+        out = trace_put(out,",\"ts\":");
+        out = trace_put_uint(out,time/1000);
+        *out++ = '.';
+        *out++ = (char)('0' + time/100%10);
+        *out++ = (char)('0' + time/10%10);
+        *out++ = (char)('0' + time%10);
+        out = trace_put(out,ids);
+        out = trace_put_uint(out,event->thread);
+        if (event->name != NULL && instance != NULL) {
+            out = trace_put(out,",\"args\":{\"instance\":\"");
+            out = trace_put(out,instance);
+            out = trace_put(out,"\"}");
+        }
+        out = trace_put(out,"},\n");
+        trace_events.chunk_used = (size_t)(out - trace_events.chunk);
+    }
+    trace_write_chunk();
+    trace_events.used = 0;
+}
+
+static FMU_INLINE void trace_record(size_t instance, const char* name)
+{
+    fmi3UInt64 ticks = fmu_ticks();
+    TraceEvent* event;
+    if (name == NULL && trace_thread_depth == 0)
+        return;
+    if (trace_thread_id == 0)
+        trace_thread_id = fmu_thread_id();
+    trace_lock();
+    if (trace_events.users == 0) {
+        trace_unlock();
+        return;
+    }
+    if (trace_events.events == NULL) {
+        trace_events.events = malloc(TRACE_EVENTS_BUFFER_SIZE*sizeof(TraceEvent));
+        trace_events.used = 0;
+        trace_events.start_ticks = ticks;
+        trace_events.start_ns = fmu_now_ns();
+    }
+    if (trace_events.events != NULL) {
+        if (trace_events.used == TRACE_EVENTS_BUFFER_SIZE)
+            trace_write();
+        event = &trace_events.events[trace_events.used++];
+        event->ticks = ticks;
+        event->thread = trace_thread_id;
+        event->name = name;
+        event->instance = instance;
+        if (name != NULL)
+            trace_thread_depth++;
+        else
+            trace_thread_depth--;
+    }
+    trace_unlock();
+}
+
+#define trace_begin(instance,name) trace_record((instance),(name))
+
+static char* trace_escape(const char* name)
+{
+    char* escaped = malloc(6*TRACE_EVENTS_MAX_NAME+1);
+    size_t i, used = 0;
+    if (escaped == NULL)
+        return NULL;
+    for (i = 0; name[i] != '\0' && i<TRACE_EVENTS_MAX_NAME; i++) {
+        unsigned char c = (unsigned char)name[i];
+        if (c == '"' || c == '\\') {
+            escaped[used++] = '\\';
+            escaped[used++] = (char)c;
+        } else if (c < 0x20) {
+            used += (size_t)sprintf(escaped+used,"\\u%04x",c);
+        } else {
+            escaped[used++] = (char)c;
+        }
+    }
+    escaped[used] = '\0';
+    return escaped;
+}
+
+/* Register an instance name, returning its instance id (0 on failure) */
+static FMU_INLINE size_t trace_attach(const char* name)
+{
+    size_t id = 0, i;
+    char* escaped = trace_escape(name != NULL ? name : "");
+    if (escaped == NULL)
+        return 0;
+    trace_lock();
+    for (i = 0; i<trace_events.instance_count; i++)
+        if (trace_events.instances[i] == NULL)
+            break;
+    if (i == trace_events.instance_count) {
+        char** instances = realloc(trace_events.instances,(i+1)*sizeof(char*));
+        if (instances != NULL) {
+            trace_events.instances = instances;
+            trace_events.instance_count++;
+        }
+    }
+    if (i < trace_events.instance_count) {
+        trace_events.instances[i] = escaped;
+        trace_events.users++;
+        id = i+1;
+    } else {
+        free(escaped);
+    }
+    trace_unlock();
+    return id;
+}
+
+/* Write out the events so far and unregister the instance name */
+static FMU_INLINE void trace_detach(size_t id)
+{
+    if (id == 0)
+        return;
+    trace_lock();
+    trace_write();
+    free(trace_events.instances[id-1]);
+    trace_events.instances[id-1] = NULL;
+    if (--trace_events.users == 0) {
+        free(trace_events.instances);
+        trace_events.instances = NULL;
+        trace_events.instance_count = 0;
+        free(trace_events.events);
+        trace_events.events = NULL;
+        if (trace_events.file != NULL)
+            fclose(trace_events.file);
+        trace_events.file = NULL;
+    }
+    trace_unlock();
+}
+
+#else
+#define trace_attach(name) 0
+#define trace_detach(id) ((void)0)
+#define trace_begin(instance,name) ((void)0)
+#endif
+
+/* The end hooks also fire the exit probe of UsdtProbes.h */
+#if defined(TRACE_EVENTS_PATH) || defined(USDT_PROBES)
+/* A function, so that the end event follows e.g. the doCalc it returns */
+static FMU_INLINE fmi3Status trace_exit(const char* function, fmi3Status status)
+{
+#ifdef TRACE_EVENTS_PATH
+    trace_record(0,NULL);
+#endif
+    probe_exit(function,status);
+    return status;
+}
+
+#define trace_end() ((void)trace_exit(__func__,fmi3OK))
+#define trace_return(status) trace_exit(__func__,(status))
+#else
+#define trace_end() ((void)0)
+#define trace_return(status) (status)
+#endif
+
+#endif /* TRACE_EVENTS_H */
@@ -0,0 +1,49 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef USDT_PROBES_H
+#define USDT_PROBES_H
+
+/*
+ * USDT Probes
+ *
+ * With USDT_PROBES defined, every exported FMI function as well as
+ * doCalc and doInitCalc carry user-level statically defined
+ * tracepoints of provider fmu (from sys/sdt.h, as used by bpftrace,
+ * BCC, perf and SystemTap), which are a single nop until a tracer
+ * attaches to them:
+ *
+ *   fmu:entry(function, instance, count, step)   on entry (probe_entry)
+ *   fmu:exit(function, status)                   on every way out
+ *
+ * function is the name of the C function, instance the instance
+ * pointer (NULL before there is one), count the number of value
+ * references passed to getters and setters, and step the
+ * communication step size of fmi3DoStep and doCalc in nanoseconds, as
+ * tracers do not handle floating point arguments well; both are 0
+ * elsewhere.  status is the returned fmi3Status, or 0 for functions
+ * returning something else.  The exit probe is fired by trace_end and
+ * trace_return (see TraceEvents.h), which already mark every way out.
+ *
+ * Requires CommonUtil.h to be included beforehand.
+ */
+#ifdef USDT_PROBES
+#include <sys/sdt.h>
+
+#define probe_entry(instance,count,step) \
+    DTRACE_PROBE4(fmu,entry,(const char*)__func__,(instance),(fmi3UInt64)(count),(fmi3Int64)((step)*1e9))
+#define probe_exit(function,status) \
+    DTRACE_PROBE2(fmu,exit,(function),(fmi3Int32)(status))
+#else
+#define probe_entry(instance,count,step) ((void)0)
+#define probe_exit(function,status) ((void)0)
+#endif
+
+#endif /* USDT_PROBES_H */
@@ -0,0 +1,118 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef VENDOR_EXTENSIONS_H
+#define VENDOR_EXTENSIONS_H
+
+/*
+ * Vendor Extensions
+ *
+ * Additional functions exported by the test FMUs besides the FMI 3.0
+ * API, for hosts that know about them and look them up explicitly.
+ * Their names use the fmi3x prefix and are not affected by
+ * FMI3_FUNCTION_PREFIX.  Requires the FMI 3.0 type headers to be
+ * included beforehand.
+ */
+
+/*
+ * Error Counters
+ *
+ * Each instance counts the errors it reported (whether or not they
+ * were passed to the logger) by kind.  fmi3xGetErrorCounts copies the
+ * first nCounts counters into counts, with kinds unknown to the FMU
+ * reading as zero.  The counters are not part of the FMU state.
+ */
+#define FMI3X_ERROR_VALUE_REFERENCE 0 /* Invalid value references or accessors */
+#define FMI3X_ERROR_ARGUMENT        1 /* Other invalid arguments or values */
+#define FMI3X_ERROR_FMU_STATE       2 /* Invalid FMU states or serialized states */
+#define FMI3X_ERROR_MEMORY          3 /* Out of memory */
+#define FMI3X_ERROR_UNSUPPORTED     4 /* Unsupported functions */
+#define FMI3X_ERROR_KINDS           5
+
+typedef fmi3Status fmi3xGetErrorCountsTYPE(fmi3Instance instance, fmi3UInt64 counts[], size_t nCounts);
+
+/*
+ * Prepared Access
+ *
+ * For hosts that exchange the same value references every step,
+ * fmi3xPrepareAccess checks a list of value references of one type
+ * (FMI3X_TYPE_*) once, for getting or (with set true) for setting,
+ * and compiles it into a plan of the spans of instance storage it
+ * covers, returning the number of values it transfers in nValues.
+ * fmi3xGetPrepared and fmi3xSetPrepared then transfer exactly these
+ * values like the corresponding fmi3Get and fmi3Set functions would,
+ * with one copy per span and no further checks of the value
+ * references.  Plans belong to the instance that prepared them and
+ * are freed with fmi3xFreePrepared or together with the instance.
+ * A plan of DynamicArrayTest becomes invalid (and executing it an
+ * error) once its arrays were resized or moved, e.g. by leaving
+ * configuration mode, restoring an FMU state of a different size or
+ * binding an input or output buffer, after which it has to be
+ * prepared again.
+ */
+#define FMI3X_TYPE_FLOAT32 0
+#define FMI3X_TYPE_FLOAT64 1
+#define FMI3X_TYPE_INT8    2
+#define FMI3X_TYPE_UINT8   3
+#define FMI3X_TYPE_INT16   4
+#define FMI3X_TYPE_UINT16  5
+#define FMI3X_TYPE_INT32   6
+#define FMI3X_TYPE_UINT32  7
+#define FMI3X_TYPE_INT64   8
+#define FMI3X_TYPE_UINT64  9
+#define FMI3X_TYPE_BOOLEAN 10
+
+typedef struct fmi3xAccessPlanStruct* fmi3xAccessPlan;
+
+typedef fmi3Status fmi3xPrepareAccessTYPE(fmi3Instance instance, int type, fmi3Boolean set, const fmi3ValueReference valueReferences[], size_t nValueReferences, size_t* nValues, fmi3xAccessPlan* plan);
+typedef fmi3Status fmi3xGetPreparedTYPE(fmi3Instance instance, fmi3xAccessPlan plan, void* values, size_t nValues);
+typedef fmi3Status fmi3xSetPreparedTYPE(fmi3Instance instance, fmi3xAccessPlan plan, const void* values, size_t nValues);
+typedef fmi3Status fmi3xFreePreparedTYPE(fmi3Instance instance, fmi3xAccessPlan plan);
+
+/*
+ * Shared Arrays
+ *
+ * Only exported by DynamicArrayTest, for its input array (value
+ * reference 4) and output array (value reference 5).
+ *
+ * fmi3xBorrowFloat64Output returns a read-only pointer to the nValues
+ * values of the output, without copying them, together with the
+ * generation of the output, which changes whenever the output values
+ * change or move.  The pointer and values stay valid until the next
+ * fmi3DoStep, fmi3SetFMUState, fmi3ExitConfigurationMode, fmi3Reset,
+ * fmi3xBindFloat64Output or fmi3FreeInstance; comparing generations
+ * tells whether they still are.
+ *
+ * fmi3xBindFloat64Output makes the FMU calculate the output directly
+ * into a host buffer of exactly nValues values (the current output
+ * size) from then on, starting with a copy of the current output.
+ * The buffer must stay valid and must not be written by the host
+ * while it is bound.  It is unbound (with the output copied back into
+ * the FMU) by binding NULL, and implicitly when the output changes
+ * size, by leaving configuration mode or restoring an FMU state, and
+ * by fmi3Reset or fmi3FreeInstance.
+ *
+ * fmi3xBindFloat64Input likewise makes the FMU read the input directly
+ * from a host buffer of exactly nValues values (the current input
+ * size) instead of from its own copy set through fmi3SetFloat64.  The
+ * FMU never writes to the buffer, so one buffer can be bound to
+ * several instances.  The buffer must stay valid while it is bound;
+ * the host may change its contents between calls, but not during a
+ * call into any instance it is bound to.  Setting the input while it
+ * is bound is an error.  It is unbound (with the input copied into
+ * the FMU) by binding NULL, and implicitly when the input changes size
+ * by leaving configuration mode, by fmi3SetFMUState, which restores
+ * the input of the state, and by fmi3Reset or fmi3FreeInstance.
+ */
+typedef fmi3Status fmi3xBorrowFloat64OutputTYPE(fmi3Instance instance, fmi3ValueReference valueReference, const fmi3Float64** values, size_t* nValues, fmi3UInt64* generation);
+typedef fmi3Status fmi3xBindFloat64OutputTYPE(fmi3Instance instance, fmi3ValueReference valueReference, fmi3Float64 buffer[], size_t nValues);
+typedef fmi3Status fmi3xBindFloat64InputTYPE(fmi3Instance instance, fmi3ValueReference valueReference, const fmi3Float64 buffer[], size_t nValues);
+
+#endif /* VENDOR_EXTENSIONS_H */
@@ -0,0 +1,327 @@
+/*
+ * PMSF FMU Framework for FMI 3.0 Co-Simulation FMUs
+ *
+ * (C) 2016 -- 2025 PMSF IT Consulting Pierre R. Mai
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "fmi3PlatformTypes.h"
+#include "fmi3FunctionTypes.h"
+#include "CommonUtil.h"
+#include "BinaryLog.h"
+
+/*
+ * Binary Log Decoder
+ *
+ * Renders binary private log files written by FMUs built with
+ * PRIVATE_LOG_BINARY (see BinaryLog.h) to text, one line per message
+ * in the order recorded, as
+ *
+ *   <seconds since first message> <model>::<instance><address> [<category>]: <message>
+ *
+ * The file must be decoded on a host of the same byte order as the
+ * one it was written on.
+ */
+
+#define DECODER_MESSAGE_SIZE 4096
+
+typedef struct {
+    fmi3UInt64 id;
+    char* format;
+} DecoderFormat;
+
+typedef struct {
+    DecoderFormat* formats;
+    size_t count;
+    size_t capacity;
+    fmi3UInt64 first_timestamp;
+    int have_timestamp;
+} Decoder;
+
+static int take(const fmi3Byte** in, const fmi3Byte* end, void* value, size_t size)
+{
+    if ((size_t)(end - *in) < size)
+        return 0;
+    memcpy(value,*in,size);
+    *in += size;
+    return 1;
+}
+
+/* Read a uint16 length prefixed string into a buffer of BINARY_LOG_MAX_STRING+1 */
+static int take_string(const fmi3Byte** in, const fmi3Byte* end, char* value)
+{
+    fmi3UInt16 length;
+    if (!take(in,end,&length,sizeof(length)) || length > BINARY_LOG_MAX_STRING || !take(in,end,value,length))
+        return 0;
+    value[length] = '\0';
+    return 1;
+}
+
+/* Later definitions of an id replace earlier ones, e.g. from an earlier process */
+static int define_format(Decoder* decoder, fmi3UInt64 id, const char* format)
+{
+    char* copy = malloc(strlen(format)+1);
+    size_t i;
+    if (copy == NULL)
+        return 0;
+    strcpy(copy,format);
+    for (i = 0; i<decoder->count; i++)
+        if (decoder->formats[i].id == id) {
+            free(decoder->formats[i].format);
+            decoder->formats[i].format = copy;
+            return 1;
+        }
+    if (decoder->count == decoder->capacity) {
+        size_t capacity = decoder->capacity ? 2*decoder->capacity : 64;
+        DecoderFormat* formats = realloc(decoder->formats,capacity*sizeof(DecoderFormat));
+        if (formats == NULL) {
+            free(copy);
+            return 0;
+        }
+        decoder->formats = formats;
+        decoder->capacity = capacity;
+    }
+    decoder->formats[decoder->count].id = id;
+    decoder->formats[decoder->count].format = copy;
+    decoder->count++;
+    return 1;
+}
+
+static const char* find_format(const Decoder* decoder, fmi3UInt64 id)
+{
+    size_t i;
+    for (i = 0; i<decoder->count; i++)
+        if (decoder->formats[i].id == id)
+            return decoder->formats[i].format;
+    return NULL;
+}
+
+static void append(char* out, size_t size, size_t* used, const char* text, size_t length)
+{
+    if (*used + length >= size)
+        length = size - 1 - *used;
+    memcpy(out+*used,text,length);
+    *used += length;
+    out[*used] = '\0';
+}
+
+#define RENDER_PIECE(value) \
+    ((conversion.stars == 0) ? snprintf(piece,sizeof(piece),spec,value) : \
+     (conversion.stars == 1) ? snprintf(piece,sizeof(piece),spec,stars[0],value) : \
+                               snprintf(piece,sizeof(piece),spec,stars[0],stars[1],value))
+
+/* Re-run the formatting the FMU skipped, with the recorded arguments */
+static int render_message(const char* format, const fmi3Byte** in, const fmi3Byte* end, char* out, size_t size)
+{
+    BinaryLogConversion conversion;
+    size_t position = 0, used = 0;
+    char spec[64], piece[BINARY_LOG_MAX_STRING+256], string[BINARY_LOG_MAX_STRING+1];
+
+    out[0] = '\0';
+    while (binary_log_next_conversion(format,position,&conversion)) {
+        size_t prefix = conversion.end - 1 - strlen(conversion.length) - conversion.start;
+        int stars[2] = { 0, 0 }, star;
+        append(out,size,&used,format+position,conversion.start-position);
+        position = conversion.end;
+        for (star = 0; star<conversion.stars; star++) {
+            fmi3Int64 value;
+            if (!take(in,end,&value,sizeof(value)))
+                return 0;
+            stars[star] = (int)value;
+        }
+        if (prefix+4 > sizeof(spec))
+            return 0;
+        memcpy(spec,format+conversion.start,prefix);
+        spec[prefix] = '\0';
+        piece[0] = '\0';
+        switch (conversion.argument) {
+            case BINARY_LOG_ARG_NONE:
+                strcpy(piece,"%");
+                break;
+            case BINARY_LOG_ARG_INT: {
+                fmi3Int64 value;
+                if (!take(in,end,&value,sizeof(value)))
+                    return 0;
+                if (conversion.conversion == 'c') {
+                    strcat(spec,"c");
+                    RENDER_PIECE((int)value);
+                } else {
+                    sprintf(spec+prefix,"ll%c",conversion.conversion);
+                    RENDER_PIECE((long long)value);
+                }
+                break;
+            }
+            case BINARY_LOG_ARG_UINT: {
+                fmi3UInt64 value;
+                if (!take(in,end,&value,sizeof(value)))
+                    return 0;
+                sprintf(spec+prefix,"ll%c",conversion.conversion);
+                RENDER_PIECE((unsigned long long)value);
+                break;
+            }
+            case BINARY_LOG_ARG_DOUBLE: {
+                fmi3Float64 value;
+                if (!take(in,end,&value,sizeof(value)))
+                    return 0;
+                sprintf(spec+prefix,"%c",conversion.conversion);
+                RENDER_PIECE(value);
+                break;
+            }
+            case BINARY_LOG_ARG_POINTER: {
+                fmi3UInt64 value;
+                if (!take(in,end,&value,sizeof(value)))
+                    return 0;
+                if (conversion.conversion == 'p') {
+                    strcat(spec,"p");
+                    RENDER_PIECE((void*)(size_t)value);
+                }
+                break;
+            }
+            case BINARY_LOG_ARG_STRING:
+                if (!take_string(in,end,string))
+                    return 0;
+                strcat(spec,"s");
+                RENDER_PIECE(string);
+                break;
+        }
+        piece[sizeof(piece)-1] = '\0';
+        append(out,size,&used,piece,strlen(piece));
+    }
+    append(out,size,&used,format+position,strlen(format+position));
+    return 1;
+}
+
+static int decode_chunk(Decoder* decoder, const fmi3Byte* in, const fmi3Byte* end, FILE* output)
+{
+    char model_name[BINARY_LOG_MAX_STRING+1], instance_name[BINARY_LOG_MAX_STRING+1];
+    char format[BINARY_LOG_MAX_STRING+1], message[DECODER_MESSAGE_SIZE];
+    fmi3UInt64 instance, clock[4];
+    double ns_per_tick = 1.0;
+
+    if (!take(&in,end,&instance,sizeof(instance)) || !take(&in,end,clock,sizeof(clock)) ||
+        !take_string(&in,end,model_name) || !take_string(&in,end,instance_name))
+        return 0;
+    /* Tick rate from the (ticks, ns) pairs at instantiation and at the write */
+    if (clock[2] > clock[0])
+        ns_per_tick = (double)(clock[3] - clock[1]) / (double)(clock[2] - clock[0]);
+
+    while (in < end) {
+        fmi3UInt8 type, category;
+        fmi3UInt64 id, ticks, timestamp;
+        const char* message_format;
+        if (!take(&in,end,&type,sizeof(type)))
+            return 0;
+        switch (type) {
+            case BINARY_LOG_RECORD_FORMAT:
+                if (!take(&in,end,&id,sizeof(id)) || !take_string(&in,end,format) || !define_format(decoder,id,format))
+                    return 0;
+                break;
+            case BINARY_LOG_RECORD_MESSAGE:
+                if (!take(&in,end,&category,sizeof(category)) || !take(&in,end,&ticks,sizeof(ticks)) || !take(&in,end,&id,sizeof(id)))
+                    return 0;
+                message_format = find_format(decoder,id);
+                if (message_format == NULL || !render_message(message_format,&in,end,message,sizeof(message)))
+                    return 0;
+                timestamp = clock[1] + (fmi3UInt64)((double)(fmi3Int64)(ticks - clock[0]) * ns_per_tick);
+                if (!decoder->have_timestamp) {
+                    decoder->first_timestamp = timestamp;
+                    decoder->have_timestamp = 1;
+                }
+                fprintf(output,"%.9f %s::%s<0x%llx> [%s]: %s\n",
+                    (double)(fmi3Int64)(timestamp - decoder->first_timestamp)*1e-9,
+                    model_name,instance_name,(unsigned long long)instance,log_category_name(category),message);
+                break;
+            default:
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static fmi3Byte* read_file(const char* path, size_t* size)
+{
+    FILE* file = fopen(path,"rb");
+    fmi3Byte* data = NULL;
+    size_t capacity = 0;
+    *size = 0;
+    if (file == NULL)
+        return NULL;
+    for (;;) {
+        size_t got;
+        if (*size == capacity) {
+            fmi3Byte* grown = realloc(data,capacity ? 2*capacity : 1<<20);
+            if (grown == NULL) {
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+            capacity = capacity ? 2*capacity : 1<<20;
+        }
+        got = fread(data+*size,1,capacity-*size,file);
+        *size += got;
+        if (got == 0)
+            break;
+    }
+    fclose(file);
+    return data;
+}
+
+int main(int argc, char* argv[])
+{
+    Decoder decoder = { NULL, 0, 0, 0, 0 };
+    FILE* output = stdout;
+    fmi3Byte* data;
+    size_t size, offset = 0, i;
+    int ok = 1;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr,"Usage: %s <binary log file> [<text output file>]\n",argv[0]);
+        return 2;
+    }
+    data = read_file(argv[1],&size);
+    if (data == NULL) {
+        fprintf(stderr,"%s: cannot read %s\n",argv[0],argv[1]);
+        return 2;
+    }
+    if (argc == 3 && (output = fopen(argv[2],"w")) == NULL) {
+        fprintf(stderr,"%s: cannot open %s\n",argv[0],argv[2]);
+        free(data);
+        return 2;
+    }
+
+    while (ok && offset < size) {
+        fmi3UInt32 magic, length;
+        if (size-offset < 2*sizeof(fmi3UInt32)) {
+            ok = 0;
+            break;
+        }
+        memcpy(&magic,data+offset,sizeof(magic));
+        memcpy(&length,data+offset+sizeof(magic),sizeof(length));
+        offset += 2*sizeof(fmi3UInt32);
+        if (magic != BINARY_LOG_CHUNK_MAGIC || length > size-offset) {
+            ok = 0;
+            break;
+        }
+        ok = decode_chunk(&decoder,data+offset,data+offset+length,output);
+        offset += length;
+    }
+    if (!ok)
+        fprintf(stderr,"%s: corrupt or truncated chunk in %s\n",argv[0],argv[1]);
+
+    if (output != stdout)
+        fclose(output);
+    for (i = 0; i<decoder.count; i++)
+        free(decoder.formats[i].format);
+    free(decoder.formats);
+    free(data);
+    return ok ? 0 : 1;
+}